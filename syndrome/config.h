@@ -36,3 +36,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 #define VIA_CUSTOM_LIGHTING_ENABLE
+
+/* RGB matrix */
+// Blank the LEDs as soon as the host suspends, the effect state is kept for wake
+#define RGB_MATRIX_SLEEP
+
+/* Matrix */
+#ifdef SYNDROME_ISR_SCAN
+// Edges are debounced in the scan interrupt, see matrix.c
+#    define DEBOUNCE 0
+#endif
+
+/* OS detection */
+// Settle sooner than the default, the cached OS (see syndrome.c) covers the gap
+#define OS_DETECTION_DEBOUNCE 100
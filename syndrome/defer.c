@@ -0,0 +1,152 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "defer.h"
+#include "timer_us.h"
+
+_Static_assert(DEFER_MAX < 255, "defer: DEFER_MAX must fit a token");
+
+typedef struct {
+    uint32_t         deadline;
+    defer_callback_t callback;
+    void            *arg;
+    defer_token_t    token;
+} defer_entry_t;
+
+static defer_entry_t heap[DEFER_MAX];
+static uint8_t       heap_size  = 0;
+static defer_token_t last_token = DEFER_INVALID_TOKEN;
+
+static inline bool earlier(uint8_t a, uint8_t b) {
+    return (int32_t)(heap[a].deadline - heap[b].deadline) < 0;
+}
+
+static inline void swap(uint8_t a, uint8_t b) {
+    defer_entry_t entry = heap[a];
+    heap[a]             = heap[b];
+    heap[b]             = entry;
+}
+
+static void sift_up(uint8_t index) {
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!earlier(index, parent)) {
+            break;
+        }
+        swap(index, parent);
+        index = parent;
+    }
+}
+
+static void sift_down(uint8_t index) {
+    for (;;) {
+        uint8_t child = 2 * index + 1;
+        if (child >= heap_size) {
+            break;
+        }
+        if (child + 1 < heap_size && earlier(child + 1, child)) {
+            child++;
+        }
+        if (!earlier(child, index)) {
+            break;
+        }
+        swap(index, child);
+        index = child;
+    }
+}
+
+static void remove_at(uint8_t index) {
+    heap[index] = heap[--heap_size];
+    if (index < heap_size) {
+        sift_up(index);
+        sift_down(index);
+    }
+}
+
+static int find(defer_token_t token) {
+    if (token == DEFER_INVALID_TOKEN) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < heap_size; i++) {
+        if (heap[i].token == token) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static defer_token_t next_token(void) {
+    // Skip the invalid token and any still pending, at most DEFER_MAX of them.
+    do {
+        last_token++;
+    } while (last_token == DEFER_INVALID_TOKEN || find(last_token) >= 0);
+    return last_token;
+}
+
+defer_token_t defer_exec_us(uint32_t delay_us, defer_callback_t callback, void *arg) {
+    if (heap_size == DEFER_MAX) {
+        return DEFER_INVALID_TOKEN;
+    }
+    heap[heap_size] = (defer_entry_t){
+        .deadline = timer_read_us() + delay_us,
+        .callback = callback,
+        .arg      = arg,
+        .token    = next_token(),
+    };
+    sift_up(heap_size++);
+    return last_token;
+}
+
+bool defer_extend_us(defer_token_t token, uint32_t delay_us) {
+    int index = find(token);
+    if (index < 0) {
+        return false;
+    }
+    heap[index].deadline = timer_read_us() + delay_us;
+    sift_up(index);
+    sift_down(index);
+    return true;
+}
+
+bool defer_cancel(defer_token_t token) {
+    int index = find(token);
+    if (index < 0) {
+        return false;
+    }
+    remove_at(index);
+    return true;
+}
+
+bool defer_pending(defer_token_t token) {
+    return find(token) >= 0;
+}
+
+void defer_task(void) {
+    while (heap_size && timer_expired_us(timer_read_us(), heap[0].deadline)) {
+        defer_entry_t entry = heap[0];
+        remove_at(0);
+
+        // The callback may schedule or cancel others, so the entry is out of
+        // the heap while it runs and goes back in with the same token.
+        uint32_t delay = entry.callback(entry.deadline, entry.arg);
+        if (delay && heap_size < DEFER_MAX) {
+            entry.deadline += delay;
+            heap[heap_size] = entry;
+            sift_up(heap_size++);
+        }
+    }
+}
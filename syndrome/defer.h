@@ -0,0 +1,51 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * One-shot deadlines in microseconds, kept in a min-heap so an idle
+ * housekeeping pass only looks at the earliest one.
+ *
+ * A callback receives the time it was due and its argument. It returns 0 to
+ * finish, or a delay in microseconds to run again that long after it was due.
+ */
+
+// At most one deadline each from Achordion's hold and streak timers, WPM,
+// the VIA cache and the vial keymap's alt-tab; raise this when adding users.
+#ifndef DEFER_MAX
+#    define DEFER_MAX 8
+#endif
+
+typedef uint8_t defer_token_t;
+
+#define DEFER_INVALID_TOKEN 0
+
+typedef uint32_t (*defer_callback_t)(uint32_t trigger_time, void *arg);
+
+// Returns DEFER_INVALID_TOKEN when no slot is free.
+defer_token_t defer_exec_us(uint32_t delay_us, defer_callback_t callback, void *arg);
+// Moves a pending deadline to `delay_us` from now. False if it already ran.
+bool defer_extend_us(defer_token_t token, uint32_t delay_us);
+// False if the token is not pending.
+bool defer_cancel(defer_token_t token);
+bool defer_pending(defer_token_t token);
+
+void defer_task(void);
@@ -0,0 +1,257 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dmacro.h"
+
+#include <string.h>
+
+_Static_assert(MATRIX_ROWS * MATRIX_COLS <= 0x80, "dmacro: key positions must fit in 7 bits");
+
+#define DMACRO_PRESSED 0x80
+#define DMACRO_VARINT  0x80
+#define DMACRO_MAX_TICKS 0x7FFF
+
+// Slots are stored back to back in slot order, so only their lengths are kept.
+typedef struct {
+    uint16_t length[DMACRO_SLOTS];
+    uint8_t  data[DMACRO_BUFFER_SIZE];
+} dmacro_store_t;
+
+#ifdef DMACRO_PERSIST
+_Static_assert(EECONFIG_KB_DATA_SIZE >= sizeof(dmacro_store_t), "dmacro: EECONFIG_KB_DATA_SIZE is too small");
+#endif
+
+static dmacro_store_t store;
+
+static uint8_t  record_slot = DMACRO_NONE;
+static uint16_t record_start;   // Offset the new recording is written at
+static uint16_t record_end;     // Write position
+static uint16_t record_last;    // event.time of the last recorded event
+static uint8_t  record_residue; // Milliseconds not yet accounted for in a tick
+static uint8_t  record_held[(MATRIX_ROWS * MATRIX_COLS + 7) / 8];
+static uint8_t  record_held_count;
+
+static uint16_t play_pos = 0;
+static uint16_t play_end = 0;
+static uint32_t play_next;
+static bool     replaying = false;
+
+__attribute__((weak)) bool dmacro_record_start_user(uint8_t slot) {
+    return true;
+}
+
+__attribute__((weak)) bool dmacro_record_end_user(uint8_t slot) {
+    return true;
+}
+
+static uint16_t slot_offset(uint8_t slot) {
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < slot; i++) {
+        offset += store.length[i];
+    }
+    return offset;
+}
+
+static uint16_t used_bytes(void) {
+    return slot_offset(DMACRO_SLOTS);
+}
+
+static void reverse(uint8_t *begin, uint8_t *end) {
+    while (begin < --end) {
+        uint8_t tmp = *begin;
+        *begin++    = *end;
+        *end        = tmp;
+    }
+}
+
+// Moves [middle, end) in front of [begin, middle) without a scratch buffer.
+static void rotate(uint8_t *begin, uint8_t *middle, uint8_t *end) {
+    reverse(begin, middle);
+    reverse(middle, end);
+    reverse(begin, end);
+}
+
+static void save_store(void) {
+#ifdef DMACRO_PERSIST
+    eeconfig_update_kb_datablock(&store);
+#endif
+}
+
+void dmacro_init(void) {
+#ifdef DMACRO_PERSIST
+    eeconfig_read_kb_datablock(&store);
+    if (used_bytes() > DMACRO_BUFFER_SIZE) {
+        memset(&store, 0, sizeof(store));
+    }
+#endif
+}
+
+uint8_t dmacro_recording(void) {
+    return record_slot;
+}
+
+uint16_t dmacro_length(uint8_t slot) {
+    return slot < DMACRO_SLOTS ? store.length[slot] : 0;
+}
+
+bool dmacro_record_start(uint8_t slot) {
+    if (slot >= DMACRO_SLOTS || record_slot != DMACRO_NONE || play_pos != play_end) {
+        return false;
+    }
+    if (!dmacro_record_start_user(slot)) {
+        return false;
+    }
+
+    // Drop the old contents of the slot, the new ones are recorded at the end.
+    uint16_t offset = slot_offset(slot);
+    uint16_t used   = used_bytes();
+    memmove(&store.data[offset], &store.data[offset + store.length[slot]], used - offset - store.length[slot]);
+    store.length[slot] = 0;
+
+    record_slot   = slot;
+    record_start  = used_bytes();
+    record_end    = record_start;
+    record_last    = timer_read();
+    record_residue = 0;
+    memset(record_held, 0, sizeof(record_held));
+    record_held_count = 0;
+    return true;
+}
+
+// Appends one event, keeping `reserve` bytes free for releases at the end.
+static bool append_event(uint8_t position, bool pressed, uint16_t time, uint16_t reserve) {
+    uint32_t elapsed = TIMER_DIFF_16(time, record_last) + record_residue;
+    uint16_t delay   = MIN(elapsed / DMACRO_TICK_MS, DMACRO_MAX_TICKS);
+    uint8_t  size    = delay < DMACRO_VARINT ? 2 : 3;
+
+    if (record_end + size + reserve > DMACRO_BUFFER_SIZE) {
+        return false;
+    }
+    record_last    = time;
+    record_residue = delay < DMACRO_MAX_TICKS ? elapsed % DMACRO_TICK_MS : 0;
+
+    if (delay < DMACRO_VARINT) {
+        store.data[record_end++] = delay;
+    } else {
+        store.data[record_end++] = DMACRO_VARINT | (delay >> 8);
+        store.data[record_end++] = delay & 0xFF;
+    }
+    store.data[record_end++] = (pressed ? DMACRO_PRESSED : 0) | position;
+
+    uint8_t mask = 1 << (position % 8);
+    if (pressed && !(record_held[position / 8] & mask)) {
+        record_held[position / 8] |= mask;
+        record_held_count++;
+    } else if (!pressed && (record_held[position / 8] & mask)) {
+        record_held[position / 8] &= ~mask;
+        record_held_count--;
+    }
+    return true;
+}
+
+void dmacro_record_stop(void) {
+    if (record_slot == DMACRO_NONE) {
+        return;
+    }
+
+    // Release anything still held so playback never leaves keys stuck down.
+    uint16_t now = timer_read();
+    for (uint8_t position = 0; position < MATRIX_ROWS * MATRIX_COLS; position++) {
+        if (record_held[position / 8] & (1 << (position % 8))) {
+            append_event(position, false, now, 0);
+        }
+    }
+
+    // Move the recording from the end of the buffer into its slot.
+    uint16_t offset = slot_offset(record_slot);
+    rotate(&store.data[offset], &store.data[record_start], &store.data[record_end]);
+    store.length[record_slot] = record_end - record_start;
+
+    uint8_t slot = record_slot;
+    record_slot  = DMACRO_NONE;
+    save_store();
+    dmacro_record_end_user(slot);
+}
+
+static uint16_t read_delay(void) {
+    uint16_t delay = store.data[play_pos++];
+    if (delay & DMACRO_VARINT) {
+        delay = ((delay & ~DMACRO_VARINT) << 8) | store.data[play_pos++];
+    }
+    return delay;
+}
+
+bool dmacro_play(uint8_t slot) {
+    if (slot >= DMACRO_SLOTS || record_slot != DMACRO_NONE || play_pos != play_end || store.length[slot] == 0) {
+        return false;
+    }
+    play_pos  = slot_offset(slot);
+    play_end  = play_pos + store.length[slot];
+    play_next = timer_read32() + read_delay() * DMACRO_TICK_MS;
+    return true;
+}
+
+void dmacro_task(void) {
+    while (play_pos != play_end && timer_expired32(timer_read32(), play_next)) {
+        uint8_t event    = store.data[play_pos++];
+        uint8_t position = event & ~DMACRO_PRESSED;
+
+        replaying = true;
+        action_exec(MAKE_KEYEVENT(position / MATRIX_COLS, position % MATRIX_COLS, event & DMACRO_PRESSED));
+        replaying = false;
+
+        if (play_pos != play_end) {
+            play_next += read_delay() * DMACRO_TICK_MS;
+        }
+    }
+}
+
+bool process_dmacro(uint16_t keycode, keyrecord_t *record) {
+    switch (keycode) {
+        case DM_REC1:
+        case DM_REC2:
+            if (record->event.pressed) {
+                if (record_slot == DMACRO_NONE) {
+                    dmacro_record_start(keycode == DM_REC1 ? 0 : 1);
+                } else {
+                    dmacro_record_stop();
+                }
+            }
+            return false;
+        case DM_RSTP:
+            if (record->event.pressed) {
+                dmacro_record_stop();
+            }
+            return false;
+        case DM_PLY1:
+        case DM_PLY2:
+            if (record->event.pressed) {
+                dmacro_play(keycode == DM_PLY1 ? 0 : 1);
+            }
+            return false;
+    }
+
+    if (record_slot != DMACRO_NONE && !replaying && IS_KEYEVENT(record->event)) {
+        uint8_t position = record->event.key.row * MATRIX_COLS + record->event.key.col;
+        // Worst case, every held key needs a 3 byte release when recording stops.
+        uint16_t reserve = 3 * (record_held_count + (record->event.pressed ? 1 : 0));
+        if (!append_event(position, record->event.pressed, record->event.time, reserve)) {
+            dmacro_record_stop(); // Out of space
+        }
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "quantum.h"
+
+/*
+ * Compact dynamic macros, enabled with `DMACRO_ENABLE = yes` in the keymap's
+ * rules.mk in place of DYNAMIC_MACRO_ENABLE.
+ *
+ * Raw matrix events are recorded as a byte stream: a 1-2 byte delay in
+ * DMACRO_TICK_MS units followed by one byte holding the edge and key position.
+ * Playback feeds the events back through action_exec() with their original
+ * timing, so tap-hold keys and combos resolve the same way they did while
+ * recording. All slots share one buffer.
+ *
+ * DM_REC1/DM_REC2/DM_PLY1/DM_PLY2/DM_RSTP drive slots 0 and 1, further slots
+ * are reached with dmacro_record_start() and dmacro_play().
+ *
+ * Define DMACRO_PERSIST to keep macros across power cycles in the keyboard
+ * EEPROM datablock, which needs EECONFIG_KB_DATA_SIZE to be at least
+ * 2 * DMACRO_SLOTS + DMACRO_BUFFER_SIZE.
+ */
+
+#ifndef DMACRO_SLOTS
+#    define DMACRO_SLOTS 4
+#endif
+
+#ifndef DMACRO_BUFFER_SIZE
+#    define DMACRO_BUFFER_SIZE 1024
+#endif
+
+#ifndef DMACRO_TICK_MS
+#    define DMACRO_TICK_MS 2
+#endif
+
+#define DMACRO_NONE 0xFF
+
+bool dmacro_record_start(uint8_t slot);
+void dmacro_record_stop(void);
+bool dmacro_play(uint8_t slot);
+
+// Slot being recorded, or DMACRO_NONE.
+uint8_t  dmacro_recording(void);
+// Recorded size of a slot in bytes, 0 when empty.
+uint16_t dmacro_length(uint8_t slot);
+
+bool dmacro_record_start_user(uint8_t slot);
+bool dmacro_record_end_user(uint8_t slot);
+
+bool process_dmacro(uint16_t keycode, keyrecord_t *record);
+void dmacro_task(void);
+void dmacro_init(void);
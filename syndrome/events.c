@@ -0,0 +1,60 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quantum.h"
+#include "events.h"
+
+typedef struct {
+    uint8_t         mask;
+    event_handler_t handler;
+} subscriber_t;
+
+static subscriber_t subscribers[EVENTS_MAX_SUBSCRIBERS];
+static uint8_t      subscriber_count = 0;
+
+static uint8_t state[EVENT_COUNT];
+
+bool events_subscribe(uint8_t mask, event_handler_t handler) {
+    if (subscriber_count == EVENTS_MAX_SUBSCRIBERS) {
+        return false;
+    }
+    subscribers[subscriber_count++] = (subscriber_t){mask, handler};
+    return true;
+}
+
+void events_publish(event_type_t type, uint8_t value) {
+    if (state[type] == value) {
+        return;
+    }
+    state[type] = value;
+    for (uint8_t i = 0; i < subscriber_count; i++) {
+        if (subscribers[i].mask & EVENT_BIT(type)) {
+            subscribers[i].handler(type, value);
+        }
+    }
+}
+
+uint8_t events_state(event_type_t type) {
+    return state[type];
+}
+
+void events_task(void) {
+    events_publish(EVENT_MODS, get_mods() | get_oneshot_mods());
+#ifdef CAPS_WORD_ENABLE
+    events_publish(EVENT_CAPS_WORD, is_caps_word_on());
+#endif
+}
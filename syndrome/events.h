@@ -0,0 +1,60 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * State change events.
+ *
+ * Each event carries the new value of one piece of keyboard state and is
+ * only delivered when that value actually changes. Layer, lock LED and host
+ * OS changes come straight from their QMK callbacks and WPM from wpm.c;
+ * modifiers and Caps Word have none, so they are compared once per
+ * housekeeping pass here rather than by every consumer.
+ */
+
+typedef enum {
+    EVENT_LAYER,     // highest active layer
+    EVENT_MODS,      // get_mods() | get_oneshot_mods()
+    EVENT_LEDS,      // led_t raw
+    EVENT_CAPS_WORD, // is_caps_word_on()
+    EVENT_WPM,       // wpm_sustained(), published by wpm.c
+    EVENT_HOST_OS,   // os_variant_t
+    EVENT_COUNT
+} event_type_t;
+
+#define EVENT_BIT(type) (1u << (type))
+#define EVENT_ALL ((1u << EVENT_COUNT) - 1)
+
+#ifndef EVENTS_MAX_SUBSCRIBERS
+#    define EVENTS_MAX_SUBSCRIBERS 4
+#endif
+
+typedef void (*event_handler_t)(event_type_t type, uint8_t value);
+
+// Calls `handler` for every event in `mask`. False when the table is full.
+bool events_subscribe(uint8_t mask, event_handler_t handler);
+
+// Delivers `value` if it differs from the last one published for `type`.
+void events_publish(event_type_t type, uint8_t value);
+
+uint8_t events_state(event_type_t type);
+
+void events_task(void);
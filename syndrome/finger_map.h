@@ -0,0 +1,17 @@
+// Generated by scripts/gen_finger_map.py from keyboard.json, do not edit.
+
+#pragma once
+
+// Hand, finger and physical row of every matrix position, see fingers.h.
+#define FINGER_MAP { \
+    {   FM(LEFT, PINKY, 1),  FM(LEFT, MIDDLE, 1),   FM(LEFT, INDEX, 1),  FM(RIGHT, INDEX, 1),   FM(RIGHT, RING, 1),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {    FM(LEFT, RING, 1),   FM(LEFT, INDEX, 1),  FM(RIGHT, INDEX, 1), FM(RIGHT, MIDDLE, 1),  FM(RIGHT, PINKY, 1),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {   FM(LEFT, PINKY, 2),  FM(LEFT, MIDDLE, 2),   FM(LEFT, INDEX, 2),  FM(RIGHT, INDEX, 2),   FM(RIGHT, RING, 2),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {    FM(LEFT, RING, 2),   FM(LEFT, INDEX, 2),  FM(RIGHT, INDEX, 2), FM(RIGHT, MIDDLE, 2),  FM(RIGHT, PINKY, 2),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {   FM(LEFT, PINKY, 3),  FM(LEFT, MIDDLE, 3),   FM(LEFT, INDEX, 3),  FM(RIGHT, INDEX, 3),   FM(RIGHT, RING, 3),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {    FM(LEFT, RING, 3),   FM(LEFT, INDEX, 3),  FM(RIGHT, INDEX, 3), FM(RIGHT, MIDDLE, 3),  FM(RIGHT, PINKY, 3),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {   FM(LEFT, THUMB, 4),   FM(LEFT, THUMB, 4),          FINGER_NONE,  FM(RIGHT, THUMB, 4),  FM(RIGHT, THUMB, 4),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {   FM(LEFT, THUMB, 4),   FM(LEFT, THUMB, 4),  FM(RIGHT, THUMB, 4),  FM(RIGHT, THUMB, 4),  FM(RIGHT, PINKY, 1),          FINGER_NONE,          FINGER_NONE,          FINGER_NONE }, \
+    {          FINGER_NONE,          FINGER_NONE,          FINGER_NONE,          FINGER_NONE,          FINGER_NONE,   FM(LEFT, PINKY, 0),   FM(RIGHT, RING, 0),  FM(RIGHT, PINKY, 0) }, \
+    {          FINGER_NONE,          FINGER_NONE,          FINGER_NONE,          FINGER_NONE,          FINGER_NONE, FM(RIGHT, MIDDLE, 0),  FM(RIGHT, PINKY, 0),          FINGER_NONE }, \
+}
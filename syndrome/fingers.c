@@ -0,0 +1,65 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quantum.h"
+#include "fingers.h"
+#include "finger_map.h"
+
+static const uint8_t finger_map[MATRIX_ROWS][MATRIX_COLS] = FINGER_MAP;
+
+uint8_t finger_map_at(keypos_t pos) {
+    if (pos.row >= MATRIX_ROWS || pos.col >= MATRIX_COLS) {
+        return FINGER_NONE;
+    }
+    return finger_map[pos.row][pos.col];
+}
+
+bool finger_known(keypos_t pos) {
+    return finger_map_at(pos) != FINGER_NONE;
+}
+
+bool finger_right_hand(keypos_t pos) {
+    uint8_t entry = finger_map_at(pos);
+    return entry != FINGER_NONE && (entry & FINGER_HAND_RIGHT);
+}
+
+finger_t finger_of(keypos_t pos) {
+    uint8_t entry = finger_map_at(pos);
+    return entry == FINGER_NONE ? FINGER_UNKNOWN : (entry >> 4) & 0x07;
+}
+
+uint8_t finger_row(keypos_t pos) {
+    uint8_t entry = finger_map_at(pos);
+    return entry == FINGER_NONE ? 0xFF : entry & 0x0F;
+}
+
+chord_class_t chord_class(keypos_t first, keypos_t second) {
+    uint8_t a = finger_map_at(first);
+    uint8_t b = finger_map_at(second);
+    // Combos, encoders and unwired positions have no finger; treat them as
+    // the other hand so Achordion falls back to its default behaviour.
+    if (a == FINGER_NONE || b == FINGER_NONE) {
+        return CHORD_CROSS_HAND;
+    }
+    // Hand and finger, without the row.
+    a &= 0xF0;
+    b &= 0xF0;
+    if ((a ^ b) & FINGER_HAND_RIGHT) {
+        return CHORD_CROSS_HAND;
+    }
+    return a == b ? CHORD_SAME_FINGER : CHORD_SAME_HAND;
+}
@@ -0,0 +1,66 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "keyboard.h"
+
+/*
+ * Which hand and finger presses each key, from scripts/gen_finger_map.py.
+ *
+ * Each matrix position packs the hand in bit 7, the finger in bits 4-6 and
+ * the physical row, counted from the top, in bits 0-3. Positions without a
+ * switch, and the pseudo-positions of combos and encoders, are FINGER_NONE:
+ * the helpers below check for it rather than decode it.
+ */
+
+typedef enum {
+    FINGER_PINKY,
+    FINGER_RING,
+    FINGER_MIDDLE,
+    FINGER_INDEX,
+    FINGER_THUMB,
+    FINGER_UNKNOWN, // FINGER_NONE position
+} finger_t;
+
+#define FINGER_HAND_LEFT 0x00
+#define FINGER_HAND_RIGHT 0x80
+#define FINGER_NONE 0xFF // no switch at this position
+
+#define FM(hand, finger, row) (FINGER_HAND_##hand | (FINGER_##finger << 4) | (row))
+
+// How two keys pressed one after the other relate.
+typedef enum {
+    CHORD_SAME_FINGER,
+    CHORD_SAME_HAND,
+    CHORD_CROSS_HAND,
+} chord_class_t;
+
+uint8_t finger_map_at(keypos_t pos);
+
+bool finger_known(keypos_t pos);
+// False for unknown positions.
+bool     finger_right_hand(keypos_t pos);
+finger_t finger_of(keypos_t pos);
+// 0xFF for unknown positions.
+uint8_t finger_row(keypos_t pos);
+
+// Unknown positions count as the other hand.
+chord_class_t chord_class(keypos_t first, keypos_t second);
@@ -1,12 +1,15 @@
 #pragma once
 
-#define RGB_MATRIX_FRAMEBUFFER_EFFECTS
 #define RGB_MATRIX_KEYPRESSES
 #define TAPPING_TERM 145
 #define TAPPING_TERM_PER_KEY
 #define COMBO_TERM 50
 #define COMBO_MUST_TAP_PER_COMBO
+#define COMBO_SHOULD_TRIGGER
+#define COMBO_STREAK_TERM 120
 // #define LEADER_TIMEOUT 300
 // #define LEADER_PER_KEY_TIMING
 // #define ACHORDION_STREAK
+#define ACHORDION_SAME_HAND_HOLD_MS 300
+#define ACHORDION_CROSS_HAND_HOLD_MS 0
 
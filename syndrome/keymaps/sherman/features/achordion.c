@@ -21,6 +21,9 @@
  */
 
 #include "achordion.h"
+#include "timer_us.h"
+#include "defer.h"
+#include "fingers.h"
 
 #if !defined(IS_QK_MOD_TAP)
 // Attempt to detect out-of-date QMK installation, which would fail with
@@ -31,16 +34,19 @@
 // Copy of the `record` and `keycode` args for the current active tap-hold key.
 static keyrecord_t tap_hold_record;
 static uint16_t tap_hold_keycode = KC_NO;
-// Timeout timer. When it expires, the key is considered held.
-static uint16_t hold_timer = 0;
+// Timeout deadline in microseconds. When it passes, the key is considered held.
+static uint32_t hold_timer = 0;
+static defer_token_t hold_token = DEFER_INVALID_TOKEN;
 // Eagerly applied mods, if any.
 static uint8_t eager_mods = 0;
 // Flag to determine whether another key is pressed within the timeout.
 static bool pressed_another_key_before_release = false;
 
 #ifdef ACHORDION_STREAK
-// Timer for typing streak
-static uint16_t streak_timer = 0;
+// Time of the last key that continued the typing streak, in microseconds.
+static uint32_t streak_timer = 0;
+static bool streak_active = false;
+static defer_token_t streak_token = DEFER_INVALID_TOKEN;
 #else
 // When disabled, is_streak is never true
 #define is_streak false
@@ -64,12 +70,30 @@ enum {
 static uint8_t achordion_state = STATE_RELEASED;
 
 #ifdef ACHORDION_STREAK
+#define MAX_STREAK_TIMEOUT 800
+
+// Ends the streak once no key continued it for MAX_STREAK_TIMEOUT.
+static uint32_t streak_expired(uint32_t trigger_time, void* arg) {
+  const uint32_t deadline = streak_timer + MAX_STREAK_TIMEOUT * 1000;
+  if (streak_active && !timer_expired_us(trigger_time, deadline)) {
+    return deadline - trigger_time;  // Streak was extended, check again.
+  }
+  streak_active = false;
+  streak_token = DEFER_INVALID_TOKEN;
+  return 0;
+}
+
 static void update_streak_timer(uint16_t keycode, keyrecord_t* record) {
-  if (achordion_streak_continue(keycode)) {
-    // We use 0 to represent an unset timer, so `| 1` to force a nonzero value.
-    streak_timer = record->event.time | 1;
-  } else {
-    streak_timer = 0;
+  streak_active = achordion_streak_continue(keycode);
+  if (streak_active) {
+    streak_timer = event_time_us(record);
+    // A full defer heap leaves the token invalid and this retries on the next
+    // key. The streak check compares against streak_timer itself, so a streak
+    // left active meanwhile still lapses on time.
+    if (!defer_pending(streak_token)) {
+      streak_token =
+          defer_exec_us(MAX_STREAK_TIMEOUT * 1000, streak_expired, NULL);
+    }
   }
 }
 #endif
@@ -146,12 +170,47 @@ static void settle_as_tap(void) {
   recursively_process_record(&tap_hold_record, STATE_TAPPING);
 }
 
+// Settles the active key as held once `hold_timer` passes.
+static uint32_t hold_timer_expired(uint32_t trigger_time, void* arg) {
+  if (achordion_state == STATE_UNSETTLED &&
+      !timer_expired_us(trigger_time, hold_timer)) {
+    return hold_timer - trigger_time;
+  }
+  hold_token = DEFER_INVALID_TOKEN;
+  if (achordion_state == STATE_UNSETTLED) {
+    settle_as_hold();  // Timeout expired, settle the key as held.
+  }
+  return 0;
+}
+
+// Leaves hold_token invalid if the defer heap is full, see
+// process_achordion().
+static void arm_hold_timer(void) {
+  defer_cancel(hold_token);
+  const int32_t remaining = (int32_t)(hold_timer - timer_read_us());
+  hold_token = defer_exec_us(remaining > 0 ? (uint32_t)remaining : 0,
+                             hold_timer_expired, NULL);
+  if (hold_token == DEFER_INVALID_TOKEN) {
+    dprintln("Achordion: No defer slot for the hold timer.");
+  }
+}
+
 bool process_achordion(uint16_t keycode, keyrecord_t* record) {
   // Don't process events that Achordion generated.
   if (achordion_state == STATE_RECURSING) {
     return true;
   }
 
+  // The hold timer could not be armed. Settle or retry on each event, so the
+  // timeout is only late until the next event rather than lost.
+  if (achordion_state == STATE_UNSETTLED && hold_token == DEFER_INVALID_TOKEN) {
+    if (timer_expired_us(event_time_us(record), hold_timer)) {
+      settle_as_hold();
+    } else {
+      arm_hold_timer();
+    }
+  }
+
   // Determine whether the current event is for a mod-tap or layer-tap key.
   const bool is_mt = IS_QK_MOD_TAP(keycode);
   const bool is_tap_hold = is_mt || IS_QK_LAYER_TAP(keycode);
@@ -169,7 +228,8 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
         // Save info about this key.
         tap_hold_keycode = keycode;
         tap_hold_record = *record;
-        hold_timer = record->event.time + timeout;
+        hold_timer = event_time_us(record) + (uint32_t)timeout * 1000;
+        arm_hold_timer();
         pressed_another_key_before_release = false;
         eager_mods = 0;
 
@@ -235,8 +295,9 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
     const uint16_t s_timeout =
         achordion_streak_chord_timeout(tap_hold_keycode, keycode);
     const bool is_streak =
-        streak_timer && s_timeout &&
-        !timer_expired(record->event.time, (streak_timer + s_timeout));
+        streak_active && s_timeout &&
+        !timer_expired_us(event_time_us(record),
+                          streak_timer + (uint32_t)s_timeout * 1000);
 #endif
 
     // Press event occurred on a key other than the active tap-hold key.
@@ -279,7 +340,8 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
         const uint16_t timeout = achordion_timeout(keycode);
         tap_hold_keycode = keycode;
         tap_hold_record = *record;
-        hold_timer = record->event.time + timeout;
+        hold_timer = event_time_us(record) + (uint32_t)timeout * 1000;
+        arm_hold_timer();
         achordion_state = STATE_UNSETTLED;
         pressed_another_key_before_release = false;
         return false;
@@ -298,33 +360,17 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
   return true;
 }
 
-void achordion_task(void) {
-  if (achordion_state == STATE_UNSETTLED &&
-      timer_expired(timer_read(), hold_timer)) {
-    settle_as_hold();  // Timeout expired, settle the key as held.
-  }
-
-#ifdef ACHORDION_STREAK
-#define MAX_STREAK_TIMEOUT 800
-  if (streak_timer &&
-      timer_expired(timer_read(), (streak_timer + MAX_STREAK_TIMEOUT))) {
-    streak_timer = 0;  // Expired.
-  }
-#endif
-}
-
 // Returns true if `pos` on the left hand of the keyboard, false if right.
-static bool on_left_hand(keypos_t pos) {
-#ifdef SPLIT_KEYBOARD
-  return pos.row < MATRIX_ROWS / 2;
-#else
-  return (MATRIX_COLS > MATRIX_ROWS) ? pos.col < MATRIX_COLS / 2
-                                     : pos.row < MATRIX_ROWS / 2;
-#endif
-}
+// The hand comes from the physical layout, the matrix wiring is scrambled.
+static bool on_left_hand(keypos_t pos) { return !finger_right_hand(pos); }
 
 bool achordion_opposite_hands(const keyrecord_t* tap_hold_record,
                               const keyrecord_t* other_record) {
+  // Keys with no place in the layout (combos, encoders) count as opposite.
+  if (!finger_known(tap_hold_record->event.key) ||
+      !finger_known(other_record->event.key)) {
+    return true;
+  }
   return on_left_hand(tap_hold_record->event.key) !=
          on_left_hand(other_record->event.key);
 }
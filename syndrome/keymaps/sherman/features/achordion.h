@@ -72,16 +72,6 @@ extern "C" {
  */
 bool process_achordion(uint16_t keycode, keyrecord_t* record);
 
-/**
- * Matrix task function for Achordion.
- *
- * Call this function from `matrix_scan_user()` as
- *
- *     void matrix_scan_user(void) {
- *       achordion_task();
- *     }
- */
-void achordion_task(void);
 
 /**
  * Optional callback to customize which key chords are considered "held".
@@ -118,12 +108,11 @@ bool achordion_chord(uint16_t tap_hold_keycode, keyrecord_t* tap_hold_record,
  *     }
  *
  * The callback determines Achordion's timeout duration for `tap_hold_keycode`
- * in units of milliseconds. The timeout be in the range 0 to 32767 ms (upper
- * bound is due to 16-bit timer limitations). Use a timeout of 0 to bypass
- * Achordion.
+ * in units of milliseconds. Timing runs on a 32-bit microsecond clock, so the
+ * whole 16-bit range is usable. Use a timeout of 0 to bypass Achordion.
  *
  * @param tap_hold_keycode Keycode of the tap-hold key.
- * @return Timeout duration in milliseconds in the range 0 to 32767.
+ * @return Timeout duration in milliseconds.
  */
 uint16_t achordion_timeout(uint16_t tap_hold_keycode);
 
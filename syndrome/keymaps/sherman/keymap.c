@@ -20,20 +20,19 @@
 
 #include <stdio.h>
 #include "os_detection.h"
+#ifdef DMACRO_ENABLE
+#include "dmacro.h"
+#endif
 #include "features/achordion.h"
+#include "send_string_batch.h"
+#include "events.h"
+#include "timer_us.h"
+#include "fingers.h"
 
-enum layer_names {
-    _BASE,
-    _CANARY,
-    _NAV,
-    _PUN,
-    _NUM,
-    _FUN,
-    _MEDIA,
-    _MOUSE,
-    _RGB,
-    _KEY
-};
+#include "layers.h"
+#ifdef LEADER_ENABLE
+#include "leader_trie.h"
+#endif
 
 const char *human_layer_names[] =  {
     "qwerty",
@@ -55,8 +54,19 @@ void render_current_layer(void);
 void render_current_wpm(void);
 #endif
 
+#ifdef LEADER_ENABLE
+bool process_leader_trie(uint16_t keycode, keyrecord_t* record);
+#endif
+
 os_variant_t current_platform;
 
+#ifdef OS_DETECTION_ENABLE
+bool process_detected_host_os_user(os_variant_t detected_os) {
+    current_platform = detected_os;
+    return true;
+}
+#endif
+
 const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     [_BASE] = LAYOUT(
         KC_ESC,                                                                             TG(_MEDIA),   TG(_MOUSE),    TG(_RGB),      TG(_KEY),
@@ -146,22 +156,64 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     };
 #endif
 
-#ifdef ACHORDION_ENABLE
-bool process_record_user(uint16_t keycode, keyrecord_t* record) {
-    if (!process_achordion(keycode, record)) {
+#ifdef COMBO_SHOULD_TRIGGER
+// Time of the last key typed as text, see combo_should_trigger().
+static uint32_t last_typed_us = 0;
+static bool typing = false;
+
+static bool is_typing_key(uint16_t keycode, keyrecord_t* record) {
+    if (IS_QK_MOD_TAP(keycode) || IS_QK_LAYER_TAP(keycode)) {
+        if (record->tap.count == 0) {
+            return false;
+        }
+        keycode = IS_QK_MOD_TAP(keycode) ? QK_MOD_TAP_GET_TAP_KEYCODE(keycode) : QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
+    }
+    if (get_mods() & ~MOD_MASK_SHIFT) {
         return false;
     }
-    return true;
+    switch (keycode) {
+        case KC_A ... KC_Z:
+        case KC_SPC:
+        case KC_DOT:
+        case KC_COMM:
+        case KC_QUOT:
+        case KC_SCLN:
+        case KC_SLSH:
+            return true;
+    }
+    return false;
 }
 #endif
 
+bool process_record_user(uint16_t keycode, keyrecord_t* record) {
 #ifdef ACHORDION_ENABLE
-void matrix_scan_user(void) {
-    achordion_task();
-}
+    if (!process_achordion(keycode, record)) {
+        return false;
+    }
 #endif
+#ifdef LEADER_ENABLE
+    if (!process_leader_trie(keycode, record)) {
+        return false;
+    }
+#endif
+#ifdef COMBO_SHOULD_TRIGGER
+    if (record->event.pressed) {
+        typing = is_typing_key(keycode, record);
+        last_typed_us = timer_read_us();
+    }
+#endif
+    return true;
+}
 
 #ifdef ACHORDION_ENABLE
+// A tap-hold key is only held if the next key comes at least this long after
+// it; anything sooner is a roll. Never for the same finger.
+static const uint16_t chord_hold_after_ms[] = {
+    [CHORD_SAME_FINGER] = UINT16_MAX,
+    [CHORD_SAME_HAND]   = ACHORDION_SAME_HAND_HOLD_MS,
+    [CHORD_CROSS_HAND]  = ACHORDION_CROSS_HAND_HOLD_MS,
+};
+
 bool achordion_chord(uint16_t tap_hold_keycode,
                      keyrecord_t* tap_hold_record,
                      uint16_t other_keycode,
@@ -173,14 +225,14 @@ bool achordion_chord(uint16_t tap_hold_keycode,
             return true;
     }
 
-    if (tap_hold_record->event.key.col <= 2 && other_record->event.key.col >= 3) {
+    keypos_t held  = tap_hold_record->event.key;
+    keypos_t other = other_record->event.key;
+    if (finger_of(other) == FINGER_THUMB) {
         return true;
     }
-    if (tap_hold_record->event.key.col >= 3 && other_record->event.key.col <= 2) {
-        return true;
-    }
-
-    return achordion_opposite_hands(tap_hold_record, other_record);
+    uint16_t hold_after = chord_hold_after_ms[chord_class(held, other)];
+    return hold_after != UINT16_MAX &&
+           event_time_us(other_record) - event_time_us(tap_hold_record) >= hold_after * 1000UL;
 }
 #endif
 
@@ -255,20 +307,106 @@ combo_t key_combos[] = {
 #endif
 
 #ifdef LEADER_ENABLE
+    // Leader sequences are matched key by key against a trie, so a snippet is
+    // sent as soon as its sequence can't be extended rather than after
+    // LEADER_TIMEOUT, and matching costs the same however many sequences exist.
+    //
+    //   P A   ()          B A   {}          B B I   []
+    //   P I   ()<Left>    B I   {}<Left>    B B A   []<Left>
+    //
+    // The trie is generated from leader.json by scripts/gen_leader_trie.py on
+    // every build. To add a sequence, add its snippet here and list it there.
+    enum leader_snippet {
+        SNIP_PARENS,
+        SNIP_PARENS_IN,
+        SNIP_BRACES,
+        SNIP_BRACES_IN,
+        SNIP_BRACKETS,
+        SNIP_BRACKETS_IN,
+        SNIP_NONE = 0xFF
+    };
+
+    static const char PROGMEM snip_parens[]      = "()";
+    static const char PROGMEM snip_parens_in[]   = "()" SS_TAP(X_LEFT);
+    static const char PROGMEM snip_braces[]      = "{}";
+    static const char PROGMEM snip_braces_in[]   = "{}" SS_TAP(X_LEFT);
+    static const char PROGMEM snip_brackets[]    = "[]";
+    static const char PROGMEM snip_brackets_in[] = "[]" SS_TAP(X_LEFT);
+
+    static const char *const PROGMEM leader_snippets[] = {
+        [SNIP_PARENS]      = snip_parens,
+        [SNIP_PARENS_IN]   = snip_parens_in,
+        [SNIP_BRACES]      = snip_braces,
+        [SNIP_BRACES_IN]   = snip_braces_in,
+        [SNIP_BRACKETS]    = snip_brackets,
+        [SNIP_BRACKETS_IN] = snip_brackets_in
+    };
+
+    typedef struct {
+        uint16_t keycode;
+        uint8_t  child;    // Index of the first child
+        uint8_t  children; // Number of children, 0 for a leaf
+        uint8_t  snippet;  // Snippet sent when the sequence ends here
+    } leader_node_t;
+
+    static const leader_node_t PROGMEM leader_trie[] = LEADER_TRIE;
+
+    static uint8_t leader_node = 0;
+
+    static void send_leader_snippet(uint8_t snippet) {
+        if (snippet != SNIP_NONE) {
+            send_string_batched_P((const char *)pgm_read_ptr(&leader_snippets[snippet]));
+        }
+    }
+
+    void leader_start_user(void) {
+        leader_node = 0;
+    }
+
+    // Only reached on timeout, when the sequence so far is a prefix of a longer one.
     void leader_end_user(void) {
-        if (leader_sequence_two_keys(KC_P, KC_A)) {
-            SEND_STRING("()");
-        } else if (leader_sequence_two_keys(KC_P, KC_I)) {
-            SEND_STRING("()" SS_TAP(X_LEFT));
-        } else if (leader_sequence_two_keys(KC_B, KC_A)) {
-            SEND_STRING("{}");
-        } else if (leader_sequence_two_keys(KC_B, KC_I)) {
-            SEND_STRING("{}" SS_TAP(X_LEFT));
-        } else if (leader_sequence_three_keys(KC_B, KC_B, KC_I)) {
-            SEND_STRING("[]");
-        } else if (leader_sequence_three_keys(KC_B, KC_B, KC_A)) {
-            SEND_STRING("[]" SS_TAP(X_LEFT));
+        send_leader_snippet(pgm_read_byte(&leader_trie[leader_node].snippet));
+        leader_node = 0;
+    }
+
+    bool process_leader_trie(uint16_t keycode, keyrecord_t* record) {
+        if (!record->event.pressed || !leader_sequence_active() || leader_sequence_timed_out() || keycode == QK_LEADER) {
+            return true;
+        }
+
+        // Match the tap keycode of mod-taps and layer-taps, like QMK's leader does.
+        if (IS_QK_MOD_TAP(keycode)) {
+            keycode = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+        } else if (IS_QK_LAYER_TAP(keycode)) {
+            keycode = QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
         }
+
+        uint8_t first = pgm_read_byte(&leader_trie[leader_node].child);
+        uint8_t last  = first + pgm_read_byte(&leader_trie[leader_node].children);
+        uint8_t next  = 0;
+        for (uint8_t i = first; i < last; i++) {
+            if (pgm_read_word(&leader_trie[i].keycode) == keycode) {
+                next = i;
+                break;
+            }
+        }
+
+        if (next == 0) {
+            // No sequence continues with this key.
+            leader_node = 0;
+            leader_end();
+        } else if (pgm_read_byte(&leader_trie[next].children) == 0) {
+            // Unambiguous, fire now instead of waiting out the timeout.
+            leader_node = 0;
+            leader_end();
+            send_leader_snippet(pgm_read_byte(&leader_trie[next].snippet));
+        } else {
+            leader_node = next;
+    #ifdef LEADER_PER_KEY_TIMING
+            leader_reset_timer();
+    #endif
+        }
+        return false;
     }
 #endif
 
@@ -319,61 +457,57 @@ combo_t key_combos[] = {
     }
 #endif
 
+#ifdef COMBO_SHOULD_TRIGGER
+    // Mid-word, combo keys are sent straight away instead of being held back
+    // for COMBO_TERM waiting for a partner. Combos work again once typing
+    // pauses for COMBO_STREAK_TERM.
+    bool combo_should_trigger(uint16_t combo_index, combo_t *combo, uint16_t keycode, keyrecord_t *record) {
+        if (!record->event.pressed || combo_index == BTN1_BTN2_BTN3) {
+            return true;
+        }
+        return !typing || timer_elapsed_us(last_typed_us) >= COMBO_STREAK_TERM * 1000;
+    }
+#endif
+
 #ifdef OLED_ENABLE
-    #ifdef DYNAMIC_MACRO_ENABLE
-        bool macro1;
-        bool macro1rec;
-        bool macro2;
-        bool macro2rec;
+    // Sections to redraw on the next OLED task: state change events, plus the macro slots.
+    #define OLED_DIRTY_DMACRO EVENT_BIT(EVENT_COUNT)
+    #define OLED_DIRTY_KEYS (EVENT_BIT(EVENT_MODS) | EVENT_BIT(EVENT_LEDS) | EVENT_BIT(EVENT_CAPS_WORD) | EVENT_BIT(EVENT_HOST_OS))
+    static uint8_t oled_dirty = EVENT_ALL | OLED_DIRTY_DMACRO;
+
+    static void mark_oled_dirty(event_type_t type, uint8_t value) {
+        oled_dirty |= EVENT_BIT(type);
+    }
+
+    void keyboard_post_init_user(void) {
+        events_subscribe(EVENT_ALL, mark_oled_dirty);
+    }
+
+    #ifdef DMACRO_ENABLE
         bool prevEnabled;
         uint8_t prevRGBmode;
 
+        // Macro slots 0 and 1 (DM_REC1/DM_REC2): shown while recording, inverted once recorded.
         void render_dynamic_macro_status(int col, int line){
-            oled_set_cursor(col,line);
-            macro1rec ? oled_write(PSTR("DM1"), macro1) : oled_write(PSTR("      "),false);
-            oled_set_cursor(col,line+1);
-            macro2rec ? oled_write(PSTR("DM2"), macro2) : oled_write(PSTR("      "),false);
+            for (uint8_t slot = 0; slot < 2; slot++) {
+                bool recording = dmacro_recording() == slot;
+                oled_set_cursor(col,line+slot);
+                (recording || dmacro_length(slot)) ? oled_write(slot ? PSTR("DM2") : PSTR("DM1"), !recording) : oled_write(PSTR("      "),false);
+            }
         }
 
-        // Direction indicates which macro it is, with 1 being Macro 1, -1 being Macro 2, and 0 being no macro.
-        bool dynamic_macro_record_start_user(int8_t direction){
+        bool dmacro_record_start_user(uint8_t slot){
             prevEnabled = rgb_matrix_is_enabled();
             if (!prevEnabled) { rgb_matrix_enable(); }
             prevRGBmode = rgb_matrix_get_mode();
             rgb_matrix_mode(RGB_MATRIX_BREATHING);
-            switch(direction){
-                case 1:
-                    macro1 = false;
-                    macro1rec = true;
-                    break;
-                case -1:
-                    macro2 = false;
-                    macro2rec = true;
-                    break;
-                default:
-                    macro1 = false;
-                    macro2 = false;
-                    macro1rec = false;
-                    macro2rec = false;
-                    break;
-            }
+            oled_dirty |= OLED_DIRTY_DMACRO;
             return true;
         }
 
-        bool dynamic_macro_record_end_user(int8_t direction){
+        bool dmacro_record_end_user(uint8_t slot){
             prevEnabled ? rgb_matrix_mode(prevRGBmode) : rgb_matrix_disable();
-            switch(direction){
-                case 1:
-                    macro1 = true;
-                    break;
-                case -1:
-                    macro2 = true;
-                    break;
-                default:
-                    macro1 = false;
-                    macro2 = false;
-                    break;
-            }
+            oled_dirty |= OLED_DIRTY_DMACRO;
             return true;
         }
     #endif
@@ -382,7 +516,7 @@ combo_t key_combos[] = {
     bool render_logo = true;
 
     void render_keylock_status(led_t led_state) {
-        bool caps_state = (led_state.caps_lock || is_caps_word_on());
+        bool caps_state = (led_state.caps_lock || events_state(EVENT_CAPS_WORD));
         oled_write(PSTR("CAPS"), caps_state);
         oled_write(PSTR(" "), false);
         oled_write(PSTR("NUM"), led_state.num_lock);
@@ -402,8 +536,8 @@ combo_t key_combos[] = {
     }
 
     void render_key_status(){
-        led_t led_state = host_keyboard_led_state();
-        uint8_t mod_state = (get_mods()|get_oneshot_mods());
+        led_t led_state = { .raw = events_state(EVENT_LEDS) };
+        uint8_t mod_state = events_state(EVENT_MODS);
         oled_set_cursor(8,0);
         render_keylock_status(led_state);
         oled_set_cursor(8,1);
@@ -412,13 +546,13 @@ combo_t key_combos[] = {
 
     void render_current_layer(){
         char PROGMEM layer[18];
-        snprintf(layer, sizeof(layer), "Layer %s", human_layer_names[get_highest_layer(layer_state)]);
+        snprintf(layer, sizeof(layer), "Layer %s", human_layer_names[events_state(EVENT_LAYER)]);
         oled_write_ln_P(layer, false);
     }
 
     void render_current_wpm(){
         oled_write_P(PSTR("WPM "), false);
-        oled_write(get_u8_str(get_current_wpm(), '0'), false);
+        oled_write(get_u8_str(events_state(EVENT_WPM), '0'), false);
     }
 
     void render_oled_logo() {
@@ -437,14 +571,22 @@ combo_t key_combos[] = {
             render_oled_logo();
             render_logo = false;
         }
-        render_key_status();
-        oled_set_cursor(8,2);
-        render_current_layer();
-        #ifdef DYNAMIC_MACRO_ENABLE
-            render_dynamic_macro_status(18,2);
-        #endif
-        oled_set_cursor(8,3);
-        render_current_wpm();
+        if (oled_dirty & OLED_DIRTY_KEYS) {
+            render_key_status();
+        }
+        // The layer line is cleared to its end, taking the macro slots with it.
+        if (oled_dirty & (EVENT_BIT(EVENT_LAYER) | OLED_DIRTY_DMACRO)) {
+            oled_set_cursor(8,2);
+            render_current_layer();
+            #ifdef DMACRO_ENABLE
+                render_dynamic_macro_status(18,2);
+            #endif
+        }
+        if (oled_dirty & EVENT_BIT(EVENT_WPM)) {
+            oled_set_cursor(8,3);
+            render_current_wpm();
+        }
+        oled_dirty = 0;
 
         return false;
     }
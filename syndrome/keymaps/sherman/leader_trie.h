@@ -0,0 +1,17 @@
+// Generated by scripts/gen_leader_trie.py from leader.json, do not edit.
+
+#pragma once
+
+// { keycode, first child, child count, snippet }, breadth first.
+#define LEADER_TRIE { \
+    /*  0 root  */ { KC_NO, 1, 2, SNIP_NONE }, \
+    /*  1 P     */ { KC_P, 3, 2, SNIP_NONE }, \
+    /*  2 B     */ { KC_B, 5, 3, SNIP_NONE }, \
+    /*  3 P A   */ { KC_A, 0, 0, SNIP_PARENS }, \
+    /*  4 P I   */ { KC_I, 0, 0, SNIP_PARENS_IN }, \
+    /*  5 B A   */ { KC_A, 0, 0, SNIP_BRACES }, \
+    /*  6 B I   */ { KC_I, 0, 0, SNIP_BRACES_IN }, \
+    /*  7 B B   */ { KC_B, 8, 2, SNIP_NONE }, \
+    /*  8 B B I */ { KC_I, 0, 0, SNIP_BRACKETS }, \
+    /*  9 B B A */ { KC_A, 0, 0, SNIP_BRACKETS_IN }, \
+}
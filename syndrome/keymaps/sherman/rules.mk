@@ -1,4 +1,5 @@
-# SRC += features/achordion.c
+SRC += features/achordion.c
+OPT_DEFS += -DACHORDION_ENABLE
 ENCODER_MAP_ENABLE = yes
 BOOTMAGIC_ENABLE = yes
 MAGIC_ENABLE = yes
@@ -6,6 +7,7 @@ MOUSEKEY_ENABLE = yes
 CAPS_WORD_ENABLE = yes
 COMBO_ENABLE = yes
 # NKRO_ENABLE = yes
-# LEADER_ENABLE = yes
-# DYNAMIC_MACRO_ENABLE = yes
-
+LEADER_ENABLE = yes
+# DMACRO_ENABLE = yes
+SPARSE_KEYMAP_ENABLE = yes
+SYNDROME_MOUSE_ENGINE = yes
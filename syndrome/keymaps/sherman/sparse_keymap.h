@@ -0,0 +1,120 @@
+// Generated by scripts/gen_sparse_keymap.py from keymap.c, do not edit.
+
+#pragma once
+
+#define SPARSE_KEYMAP_LAYERS 10
+
+// 245 stored keys, 555 taken from the layer fill.
+static const uint16_t PROGMEM sparse_fill[SPARSE_KEYMAP_LAYERS] = {
+    [_BASE] = KC_NO,
+    [_CANARY] = KC_NO,
+    [_NAV] = KC_NO,
+    [_PUN] = KC_NO,
+    [_NUM] = KC_NO,
+    [_FUN] = KC_NO,
+    [_MEDIA] = KC_NO,
+    [_MOUSE] = KC_NO,
+    [_RGB] = KC_NO,
+    [_KEY] = KC_NO,
+};
+
+// Columns of each row that differ from the fill.
+static const uint8_t PROGMEM sparse_row_bits[SPARSE_KEYMAP_LAYERS][MATRIX_ROWS] = {
+    [_BASE] = { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0B, 0x1F, 0xE0, 0x60 },
+    [_CANARY] = { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0B, 0x1F, 0xE0, 0x60 },
+    [_NAV] = { 0x0A, 0x07, 0x1E, 0x1F, 0x0B, 0x03, 0x00, 0x16, 0xE0, 0x60 },
+    [_PUN] = { 0x0F, 0x1F, 0x1F, 0x1F, 0x13, 0x1B, 0x00, 0x16, 0xE0, 0x60 },
+    [_NUM] = { 0x1A, 0x1F, 0x1F, 0x1F, 0x12, 0x1B, 0x00, 0x16, 0xE0, 0x60 },
+    [_FUN] = { 0x00, 0x00, 0x1F, 0x1F, 0x01, 0x01, 0x00, 0x06, 0xE0, 0x60 },
+    [_MEDIA] = { 0x02, 0x00, 0x03, 0x01, 0x00, 0x00, 0x08, 0x0E, 0xE0, 0x60 },
+    [_MOUSE] = { 0x02, 0x00, 0x02, 0x03, 0x00, 0x00, 0x08, 0x0E, 0xE0, 0x60 },
+    [_RGB] = { 0x12, 0x18, 0x02, 0x03, 0x00, 0x00, 0x00, 0x06, 0xE0, 0x60 },
+    [_KEY] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0xE0, 0x60 },
+};
+
+// First stored key of each layer, and of each row within it.
+static const uint16_t PROGMEM sparse_layer_base[SPARSE_KEYMAP_LAYERS] = {
+    [_BASE] = 0,
+    [_CANARY] = 43,
+    [_NAV] = 86,
+    [_PUN] = 113,
+    [_NUM] = 147,
+    [_FUN] = 179,
+    [_MEDIA] = 198,
+    [_MOUSE] = 211,
+    [_RGB] = 224,
+    [_KEY] = 238,
+};
+static const uint8_t PROGMEM sparse_row_base[SPARSE_KEYMAP_LAYERS][MATRIX_ROWS] = {
+    [_BASE] = { 0, 5, 10, 15, 20, 25, 30, 33, 38, 41 },
+    [_CANARY] = { 0, 5, 10, 15, 20, 25, 30, 33, 38, 41 },
+    [_NAV] = { 0, 2, 5, 9, 14, 17, 19, 19, 22, 25 },
+    [_PUN] = { 0, 4, 9, 14, 19, 22, 26, 26, 29, 32 },
+    [_NUM] = { 0, 3, 8, 13, 18, 20, 24, 24, 27, 30 },
+    [_FUN] = { 0, 0, 0, 5, 10, 11, 12, 12, 14, 17 },
+    [_MEDIA] = { 0, 1, 1, 3, 4, 4, 4, 5, 8, 11 },
+    [_MOUSE] = { 0, 1, 1, 2, 4, 4, 4, 5, 8, 11 },
+    [_RGB] = { 0, 2, 4, 5, 7, 7, 7, 7, 9, 12 },
+    [_KEY] = { 0, 0, 0, 0, 0, 0, 0, 0, 2, 5 },
+};
+
+static const uint16_t PROGMEM sparse_keys[] = {
+    // _BASE
+    KC_Q, KC_E, KC_T, KC_U, KC_O, KC_W,
+    KC_R, KC_Y, KC_I, KC_P, LGUI_T(KC_A), LSFT_T(KC_D),
+    KC_G, RCTL_T(KC_J), RALT_T(KC_L), LALT_T(KC_S), LCTL_T(KC_F), KC_H,
+    RSFT_T(KC_K), RGUI_T(KC_SCLN), KC_Z, KC_C, KC_B, KC_M,
+    KC_DOT, KC_X, KC_V, KC_N, KC_COMMA, KC_SLASH,
+    MO(_NAV), MO(_NUM), MO(_PUN), QK_LEAD, KC_SPC, KC_BSPC,
+    MO(_FUN), KC_QUOT, KC_ESC, TG(_MOUSE), TG(_KEY), TG(_MEDIA),
+    TG(_RGB),
+    // _CANARY
+    KC_W, KC_Y, KC_K, KC_X, KC_U, KC_L,
+    KC_P, KC_Z, KC_O, KC_SCLN, LGUI_T(KC_C), LSFT_T(KC_S),
+    KC_B, RCTL_T(KC_N), RALT_T(KC_I), LALT_T(KC_R), LCTL_T(KC_T), KC_F,
+    RSFT_T(KC_E), RGUI_T(KC_A), KC_J, KC_D, KC_Q, KC_H,
+    KC_COMM, KC_V, KC_G, KC_M, KC_SLASH, KC_DOT,
+    MO(_NAV), MO(_NUM), MO(_PUN), QK_LEAD, KC_TRNS, KC_TRNS,
+    MO(_FUN), KC_QUOT, KC_ESC, TG(_MOUSE), TG(_KEY), TG(_MEDIA),
+    TG(_RGB),
+    // _NAV
+    MS_UP, KC_PGUP, MS_BTN1, MS_BTN2, LCTL(KC_Y), MS_DOWN,
+    KC_HOME, KC_DOWN, KC_RIGHT, MS_LEFT, MS_RGHT, KC_LEFT,
+    KC_UP, KC_END, LCTL(KC_Z), LCTL(KC_C), KC_PGDN, LCTL(KC_X),
+    LCTL(KC_V), KC_TRNS, KC_TRNS, KC_DEL, KC_TRNS, KC_TRNS,
+    KC_TRNS, KC_TRNS, KC_TRNS,
+    // _PUN
+    KC_EXLM, KC_HASH, KC_PERC, KC_AMPR, KC_AT, KC_DLR,
+    KC_CIRC, KC_ASTR, KC_DQUO, KC_UNDS, KC_PLUS, KC_SLASH,
+    KC_LCTL, KC_LALT, KC_MINS, KC_EQL, KC_SLASH, KC_LSFT,
+    KC_LGUI, KC_PIPE, KC_TILD, KC_RABK, KC_BSLS, KC_GRV,
+    KC_LABK, KC_QUES, KC_TRNS, KC_TRNS, KC_QUOT, KC_TRNS,
+    KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS,
+    // _NUM
+    KC_6, KC_MINS, KC_ASTR, KC_5, KC_7, KC_UNDS,
+    KC_PLUS, KC_SLASH, KC_1, KC_3, KC_5, KC_7,
+    KC_9, KC_2, KC_4, KC_6, KC_8, KC_0,
+    KC_9, KC_TRNS, KC_8, KC_0, KC_TRNS, KC_TRNS,
+    KC_TRNS, KC_TRNS, KC_EQL, KC_TRNS, KC_TRNS, KC_TRNS,
+    KC_TRNS, KC_TRNS,
+    // _FUN
+    KC_F1, KC_F3, KC_F5, KC_F7, KC_F9, KC_F2,
+    KC_F4, KC_F6, KC_F8, KC_F10, KC_F11, KC_F12,
+    KC_TRNS, KC_TRNS, KC_TRNS, KC_NUM, KC_PSCR, KC_CAPS,
+    KC_SCRL,
+    // _MEDIA
+    MS_UP, KC_MPRV, KC_MNXT, KC_MPLY, MS_BTN3, MS_BTN1,
+    MS_BTN2, MS_BTN4, KC_MUTE, KC_TRNS, KC_TRNS, KC_TRNS,
+    KC_TRNS,
+    // _MOUSE
+    MS_UP, MS_DOWN, MS_LEFT, MS_RGHT, MS_BTN3, MS_BTN1,
+    MS_BTN2, MS_BTN4, KC_ESC, KC_TRNS, KC_TRNS, KC_TRNS,
+    KC_TRNS,
+    // _RGB
+    MS_UP, RM_HUED, RM_PREV, RM_SATD, MS_DOWN, MS_LEFT,
+    MS_RGHT, KC_TRNS, KC_TRNS, RM_TOGG, RM_HUED, RM_HUEU,
+    RM_NEXT, TG(_RGB),
+    // _KEY
+    DF(_BASE), DF(_CANARY), KC_SLEP, QK_REBOOT, KC_TRNS, QK_BOOT,
+    EE_CLR,
+};
@@ -18,6 +18,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdio.h>
 #include "os_detection.h"
+#include "defer.h"
+#include "events.h"
+#ifdef DMACRO_ENABLE
+#include "dmacro.h"
+#endif
 
 #ifdef OLED_ENABLE
 void render_key_status_or_logo(void);
@@ -26,8 +31,8 @@ void render_current_wpm(void);
 #endif
 
 os_variant_t current_platform;
+bool rerender_platform = false;
 bool is_alt_tab_active = false;
-uint16_t alt_tab_timer = 0;
 
 enum layer_names {
     _BASE, // Default Layer
@@ -49,155 +54,171 @@ enum custom_keycode {
     NXTAPP
 };
 
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
-    switch (keycode) {
-        case KC_HOME:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LGUI);
-                tap_code(KC_LEFT);
-                unregister_mods(MOD_LGUI);
-            } else {
-                tap_code(KC_HOME);
-            }
-            break;
-        case KC_END:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LGUI);
-                tap_code(KC_RIGHT);
-                unregister_mods(MOD_LGUI);
-            } else {
-                tap_code(KC_END);
-            }
-            break;
-        case KC_PGUP:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LGUI);
-                tap_code(KC_UP);
-                unregister_mods(MOD_LGUI);
-            } else {
-                tap_code(KC_PGUP);
-            }
-            break;
-        case KC_PGDN:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LGUI);
-                tap_code(KC_DOWN);
-                unregister_mods(MOD_LGUI);
-            } else {
-                tap_code(KC_PGDN);
-            }
-            break;
-        case KC_NUM_LOCK:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LSFT);
-                tap_code(KC_CLEAR);
-                unregister_mods(MOD_LSFT);
-            } else {
-                tap_code(KC_NUM_LOCK);
-            }
-            break;
-        case KC_SCROLL_LOCK:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LCTL);
-                tap_code(KC_F14);
-                unregister_mods(MOD_LCTL);
-            } else {
-                tap_code(KC_SCROLL_LOCK);
-            }
-            break;
-        case KC_PRINT_SCREEN:
-            if (record->event.pressed && current_platform == OS_MACOS) {
-                register_mods(MOD_LSFT);
-                register_mods(MOD_LGUI);
-                tap_code(KC_5);
-                unregister_mods(MOD_LGUI);
-                unregister_mods(MOD_LSFT);
-            } else {
-                tap_code(KC_PRINT_SCREEN);
-            }
-            break;
-        case JWRDL:
-            if (record->event.pressed) {
-                (current_platform == OS_MACOS) ? register_mods(MOD_LALT) : register_mods(MOD_LCTL);
-                tap_code(KC_LEFT);
-                (current_platform == OS_MACOS) ? unregister_mods(MOD_LALT) : unregister_mods(MOD_LCTL);
-            } else {
-            }
-            break;
-        case JWRDR:
-            if (record->event.pressed) {
-                (current_platform == OS_MACOS) ? register_mods(MOD_LALT) : register_mods(MOD_LCTL);
-                tap_code(KC_RIGHT);
-                (current_platform == OS_MACOS) ? unregister_mods(MOD_LALT) : unregister_mods(MOD_LCTL);
-            } else {
-            }
-            break;
-        case SWRDL:
-            if (record->event.pressed) {
-                register_mods(MOD_LSFT);
-                (current_platform == OS_MACOS) ? register_mods(MOD_LALT) : register_mods(MOD_LCTL);
-                tap_code(KC_LEFT);
-                (current_platform == OS_MACOS) ? unregister_mods(MOD_LALT) : unregister_mods(MOD_LCTL);
-                unregister_mods(MOD_LSFT);
-            } else {
-            }
+typedef struct {
+    uint16_t keycode;
+    uint16_t chord; // Modifier+key chord sent in place of keycode, e.g. LGUI(KC_LEFT)
+} os_chord_t;
+
+typedef struct {
+    const os_chord_t *chords;
+    uint8_t           count;
+    uint8_t           app_switcher; // Modifier held down while cycling through apps
+} os_keymap_t;
+
+static const os_chord_t PROGMEM chords_default[] = {
+    { JWRDL,  LCTL(KC_LEFT) },
+    { JWRDR,  LCTL(KC_RIGHT) },
+    { SWRDL,  LCTL(LSFT(KC_LEFT)) },
+    { SWRDR,  LCTL(LSFT(KC_RIGHT)) },
+    { TABL,   LCTL(LSFT(KC_TAB)) },
+    { TABR,   LCTL(KC_TAB) },
+    { DSKTPL, LCTL(LGUI(KC_LEFT)) },
+    { DSKTPR, LCTL(LGUI(KC_RGHT)) },
+};
+
+static const os_chord_t PROGMEM chords_linux[] = {
+    { JWRDL,  LCTL(KC_LEFT) },
+    { JWRDR,  LCTL(KC_RIGHT) },
+    { SWRDL,  LCTL(LSFT(KC_LEFT)) },
+    { SWRDR,  LCTL(LSFT(KC_RIGHT)) },
+    { TABL,   LCTL(LSFT(KC_TAB)) },
+    { TABR,   LCTL(KC_TAB) },
+    { DSKTPL, LCTL(LGUI(KC_UP)) },
+    { DSKTPR, LCTL(LGUI(KC_DOWN)) },
+};
+
+static const os_chord_t PROGMEM chords_macos[] = {
+    { KC_HOME,         LGUI(KC_LEFT) },
+    { KC_END,          LGUI(KC_RIGHT) },
+    { KC_PGUP,         LGUI(KC_UP) },
+    { KC_PGDN,         LGUI(KC_DOWN) },
+    { KC_NUM_LOCK,     LSFT(KC_CLEAR) },
+    { KC_SCROLL_LOCK,  LCTL(KC_F14) },
+    { KC_PRINT_SCREEN, LSFT(LGUI(KC_5)) },
+    { JWRDL,           LALT(KC_LEFT) },
+    { JWRDR,           LALT(KC_RIGHT) },
+    { SWRDL,           LALT(LSFT(KC_LEFT)) },
+    { SWRDR,           LALT(LSFT(KC_RIGHT)) },
+    { TABL,            LCTL(LSFT(KC_TAB)) },
+    { TABR,            LCTL(KC_TAB) },
+    { DSKTPL,          LCTL(LGUI(KC_LEFT)) },
+    { DSKTPR,          LCTL(LGUI(KC_RGHT)) },
+};
+
+static const os_keymap_t os_keymap_default = { chords_default, ARRAY_SIZE(chords_default), KC_LALT };
+static const os_keymap_t os_keymap_linux   = { chords_linux,   ARRAY_SIZE(chords_linux),   KC_LALT };
+static const os_keymap_t os_keymap_macos   = { chords_macos,   ARRAY_SIZE(chords_macos),   KC_LGUI };
+
+// Selected once per detected OS, so key handling never has to branch on the platform.
+static const os_keymap_t *os_keymap = &os_keymap_default;
+static uint8_t alt_tab_mod = KC_LALT;
+
+// The app switcher is held for a second after the last PRVAPP/NXTAPP.
+#define ALT_TAB_TIMEOUT_US 1000000
+static defer_token_t alt_tab_token = DEFER_INVALID_TOKEN;
+
+static uint32_t release_alt_tab(uint32_t trigger_time, void *arg) {
+    unregister_code(alt_tab_mod);
+    is_alt_tab_active = false;
+    alt_tab_token = DEFER_INVALID_TOKEN;
+    return 0;
+}
+
+static void hold_alt_tab(void) {
+    if (!is_alt_tab_active) {
+        is_alt_tab_active = true;
+        alt_tab_mod = os_keymap->app_switcher;
+        register_code(alt_tab_mod);
+    }
+    if (!defer_extend_us(alt_tab_token, ALT_TAB_TIMEOUT_US)) {
+        alt_tab_token = defer_exec_us(ALT_TAB_TIMEOUT_US, release_alt_tab, NULL);
+    }
+}
+
+static void select_os_keymap(os_variant_t os) {
+    current_platform = os;
+    switch (os) {
+        case OS_LINUX:
+            os_keymap = &os_keymap_linux;
             break;
-        case SWRDR:
-            if (record->event.pressed) {
-                register_mods(MOD_LSFT);
-                (current_platform == OS_MACOS) ? register_mods(MOD_LALT) : register_mods(MOD_LCTL);
-                tap_code(KC_RIGHT);
-                (current_platform == OS_MACOS) ? unregister_mods(MOD_LALT) : unregister_mods(MOD_LCTL);
-                unregister_mods(MOD_LSFT);
-            } else {
-            }
+        case OS_MACOS:
+            os_keymap = &os_keymap_macos;
             break;
-        case TABL:
-            if (record->event.pressed) {
-                register_mods(MOD_LCTL);
-                register_mods(MOD_LSFT);
-                tap_code(KC_TAB);
-                unregister_mods(MOD_LSFT);
-                unregister_mods(MOD_LCTL);
-            } else {
-            }
+        default:
+            os_keymap = &os_keymap_default;
             break;
-        case TABR:
-            if (record->event.pressed) {
-                register_mods(MOD_LCTL);
-                tap_code(KC_TAB);
-                unregister_mods(MOD_LCTL);
-            } else {
-            }
+    }
+}
+
+#ifdef OS_DETECTION_ENABLE
+// Called once whenever the detected (or cached, see syndrome.c) host OS changes.
+bool process_detected_host_os_user(os_variant_t detected_os) {
+    if (detected_os == current_platform) {
+        return true;
+    }
+    select_os_keymap(detected_os);
+    switch (detected_os) {
+        case OS_LINUX:
+        case OS_WINDOWS:
+            keymap_config.swap_lctl_lgui = false;
+            keymap_config.swap_rctl_rgui = false;
             break;
-        case DSKTPL:
-            if (record->event.pressed) {
-                register_mods(MOD_LCTL);
-                register_mods(MOD_LGUI);
-                (current_platform == OS_LINUX) ? tap_code(KC_UP) : tap_code(KC_LEFT);
-                unregister_mods(MOD_LGUI);
-                unregister_mods(MOD_LCTL);
-            } else {
-            }
+        case OS_MACOS:
+        case OS_IOS:
+            keymap_config.swap_lctl_lgui = true;
+            keymap_config.swap_rctl_rgui = true;
             break;
-        case DSKTPR:
-            if (record->event.pressed) {
-                register_mods(MOD_LCTL);
-                register_mods(MOD_LGUI);
-                (current_platform == OS_LINUX) ? tap_code(KC_DOWN) : tap_code(KC_RGHT);
-                unregister_mods(MOD_LGUI);
-                unregister_mods(MOD_LCTL);
-            } else {
-            }
+        default: // OS_UNSURE, keep whatever is set
             break;
+    }
+    rerender_platform = true;
+    return true;
+}
+#endif
+
+static uint16_t find_os_chord(uint16_t keycode) {
+    for (uint8_t i = 0; i < os_keymap->count; i++) {
+        if (pgm_read_word(&os_keymap->chords[i].keycode) == keycode) {
+            return pgm_read_word(&os_keymap->chords[i].chord);
+        }
+    }
+    return KC_NO;
+}
+
+// Taps a modifier+key chord with the modifiers and key in the same report,
+// rather than registering each modifier separately.
+static void tap_os_chord(uint16_t chord) {
+    uint8_t mods = QK_MODS_GET_MODS(chord);
+    uint8_t key  = QK_MODS_GET_BASIC_KEYCODE(chord);
+
+    // Keycode mods are 5-bit (right-hand flag + 4 mods), HID mods are 8-bit.
+    mods = (mods & 0x10) ? (mods & 0x0F) << 4 : mods;
+
+    add_weak_mods(mods);
+    add_key(key);
+    send_keyboard_report();
+#if TAP_CODE_DELAY > 0
+    wait_ms(TAP_CODE_DELAY);
+#endif
+    del_key(key);
+    del_weak_mods(mods);
+    send_keyboard_report();
+}
+
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    uint16_t chord = find_os_chord(keycode);
+    if (chord != KC_NO) {
+        if (record->event.pressed) {
+            tap_os_chord(chord);
+        }
+        return false;
+    }
+
+    switch (keycode) {
         case PRVAPP:
             if (record->event.pressed) {
                 register_code(KC_LSFT);
-                if (!is_alt_tab_active) {
-                    is_alt_tab_active = true;
-                    (current_platform == OS_MACOS) ? register_code(KC_LGUI) : register_code(KC_LALT);
-                }
-                alt_tab_timer = timer_read();
+                hold_alt_tab();
                 register_code(KC_TAB);
             } else {
                 unregister_code(KC_TAB);
@@ -206,11 +227,7 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
             break;
         case NXTAPP:
             if (record->event.pressed) {
-                if (!is_alt_tab_active) {
-                    is_alt_tab_active = true;
-                    (current_platform == OS_MACOS) ? register_code(KC_LGUI) : register_code(KC_LALT);
-                }
-                alt_tab_timer = timer_read();
+                hold_alt_tab();
                 register_code(KC_TAB);
             } else {
                 unregister_code(KC_TAB);
@@ -257,15 +274,6 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 		_______, _______, _______, _______, _______, _______, _______, _______)
 };
 
-void matrix_scan_user(void) { // The very important timer.
-    if (is_alt_tab_active) {
-        if (timer_elapsed(alt_tab_timer) > 1000) {
-            (current_platform == OS_MACOS) ? unregister_code(KC_LGUI) : unregister_code(KC_LALT);
-            is_alt_tab_active = false;
-        }
-    }
-}
-
 #if defined(ENCODER_MAP_ENABLE)
     const uint16_t PROGMEM encoder_map[][NUM_ENCODERS][2] = {
         [_BASE] =  { ENCODER_CCW_CW(KC_VOLD,  KC_VOLU), ENCODER_CCW_CW(RGB_RMOD, RGB_MOD), ENCODER_CCW_CW(KC_VOLD,  KC_VOLU) },
@@ -276,66 +284,50 @@ void matrix_scan_user(void) { // The very important timer.
 #endif
 
 #ifdef OLED_ENABLE
-    #ifdef DYNAMIC_MACRO_ENABLE
-        bool macro1;
-        bool macro1rec;
-        bool macro2;
-        bool macro2rec;
+    // Sections to redraw on the next OLED task: state change events, plus the macro slots.
+    #define OLED_DIRTY_DMACRO EVENT_BIT(EVENT_COUNT)
+    #define OLED_DIRTY_ALL (EVENT_ALL | OLED_DIRTY_DMACRO)
+    #define OLED_DIRTY_KEYS (EVENT_BIT(EVENT_MODS) | EVENT_BIT(EVENT_LEDS) | EVENT_BIT(EVENT_CAPS_WORD) | EVENT_BIT(EVENT_HOST_OS))
+    static uint8_t oled_dirty = OLED_DIRTY_ALL;
+
+    static void mark_oled_dirty(event_type_t type, uint8_t value) {
+        oled_dirty |= EVENT_BIT(type);
+    }
+
+    void keyboard_post_init_user(void) {
+        events_subscribe(EVENT_ALL, mark_oled_dirty);
+    }
+
+    #ifdef DMACRO_ENABLE
         bool prevEnabled;
         uint8_t prevRGBmode;
 
+        // Macro slots 0 and 1 (DM_REC1/DM_REC2): shown while recording, inverted once recorded.
         void render_dynamic_macro_status(int col, int line){
-            oled_set_cursor(col,line);
-            macro1rec ? oled_write(PSTR("DM1"), macro1) : oled_write(PSTR("      "),false);
-            oled_set_cursor(col,line+1);
-            macro2rec ? oled_write(PSTR("DM2"), macro2) : oled_write(PSTR("      "),false);
+            for (uint8_t slot = 0; slot < 2; slot++) {
+                bool recording = dmacro_recording() == slot;
+                oled_set_cursor(col,line+slot);
+                (recording || dmacro_length(slot)) ? oled_write(slot ? PSTR("DM2") : PSTR("DM1"), !recording) : oled_write(PSTR("      "),false);
+            }
         }
 
-        //direction indicates which macro it is, with 1 being Macro 1, -1 being Macro 2, and 0 being no macro.
-        bool dynamic_macro_record_start_user(int8_t direction){
+        bool dmacro_record_start_user(uint8_t slot){
             prevEnabled = rgb_matrix_is_enabled();
             if (!prevEnabled) { rgb_matrix_enable(); }
             prevRGBmode = rgb_matrix_get_mode();
             rgb_matrix_mode(RGB_MATRIX_BREATHING);
-            switch(direction){
-                case 1:
-                    macro1 = false;
-                    macro1rec = true;
-                    break;
-                case -1:
-                    macro2 = false;
-                    macro2rec = true;
-                    break;
-                default:
-                    macro1 = false;
-                    macro2 = false;
-                    macro1rec = false;
-                    macro2rec = false;
-                    break;
-            }
+            oled_dirty |= OLED_DIRTY_DMACRO;
             return true;
         }
 
-        bool dynamic_macro_record_end_user(int8_t direction){
+        bool dmacro_record_end_user(uint8_t slot){
             prevEnabled ? rgb_matrix_mode(prevRGBmode) : rgb_matrix_disable();
-            switch(direction){
-                case 1:
-                    macro1 = true;
-                    break;
-                case -1:
-                    macro2 = true;
-                    break;
-                default:
-                    macro1 = false;
-                    macro2 = false;
-                    break;
-            }
+            oled_dirty |= OLED_DIRTY_DMACRO;
             return true;
         }
     #endif
 
     bool clear_screen = false;
-    bool rerender_platform = false;
 
     static void render_logo(void) {
         static const char PROGMEM logo[] = {
@@ -348,7 +340,7 @@ void matrix_scan_user(void) { // The very important timer.
     }
 
     void render_keylock_status(led_t led_state) {
-        bool caps_state = (led_state.caps_lock || is_caps_word_on());
+        bool caps_state = (led_state.caps_lock || events_state(EVENT_CAPS_WORD));
         oled_write(PSTR("CAPS"), caps_state);
         oled_write(PSTR(" "), false);
         oled_write(PSTR("NUM"), led_state.num_lock);
@@ -367,14 +359,16 @@ void matrix_scan_user(void) { // The very important timer.
         (current_platform == OS_MACOS || current_platform == OS_IOS) ? oled_write(PSTR("CT"), (modifiers & MOD_MASK_CTRL)) : oled_write(PSTR("GUI"), (modifiers & MOD_MASK_GUI));
     }
 
+    // Both the logo and the clear wipe the other sections, which are redrawn after.
     void render_key_status_or_logo(){
-        led_t led_state = host_keyboard_led_state();
-        uint8_t mod_state = (get_mods()|get_oneshot_mods());
+        led_t led_state = { .raw = events_state(EVENT_LEDS) };
+        uint8_t mod_state = events_state(EVENT_MODS);
         if ( !led_state.num_lock && !led_state.caps_lock && !led_state.scroll_lock
         && !(mod_state & MOD_MASK_SHIFT) && !(mod_state & MOD_MASK_ALT) && !(mod_state & MOD_MASK_CTRL) && !(mod_state & MOD_MASK_GUI)) {
             if(!clear_screen) {
                 render_logo();
                 rerender_platform = true;
+                oled_dirty = OLED_DIRTY_ALL;
             }
             clear_screen = true;
         } else {
@@ -382,6 +376,7 @@ void matrix_scan_user(void) { // The very important timer.
                 oled_clear();
                 oled_render();
                 clear_screen = false;
+                oled_dirty = OLED_DIRTY_ALL;
             }
             oled_set_cursor(8,0);
             render_keylock_status(led_state);
@@ -393,7 +388,7 @@ void matrix_scan_user(void) { // The very important timer.
     }
 
     void render_current_layer(){
-        switch (get_highest_layer(layer_state)) {
+        switch (events_state(EVENT_LAYER)) {
                 case 0:
                     oled_write(PSTR("Layer 0"), false);
                     break;
@@ -413,7 +408,7 @@ void matrix_scan_user(void) { // The very important timer.
 
     void render_current_wpm(){
         oled_write_P(PSTR("WPM: "), false);
-        oled_write(get_u8_str(get_current_wpm(), '0'), false);
+        oled_write(get_u8_str(events_state(EVENT_WPM), '0'), false);
     }
 
     void render_platform_status(int col, int line) {
@@ -425,7 +420,6 @@ void matrix_scan_user(void) { // The very important timer.
             {{0x95, 0x96, 0}, {0xb5, 0xb6, 0}}, //Mac/iOS
             {{0x9D, 0x9E, 0}, {0xbd, 0xbe, 0}}, //Empty Placeholder
         };
-        current_platform = detected_host_os();
         switch (current_platform) {
             /*case OS_ANDROID: //Android
                 oled_set_cursor(col,line);
@@ -438,32 +432,24 @@ void matrix_scan_user(void) { // The very important timer.
                 oled_write(logo[1][0], false);
                 oled_set_cursor(col,line+1);
                 oled_write(logo[1][1], false);
-                keymap_config.swap_lctl_lgui = false;
-                keymap_config.swap_rctl_rgui = false;
                 break;
             case OS_WINDOWS: //Windows
                 oled_set_cursor(col,line);
                 oled_write(logo[2][0], false);
                 oled_set_cursor(col,line+1);
                 oled_write(logo[2][1], false);
-                keymap_config.swap_lctl_lgui = false;
-                keymap_config.swap_rctl_rgui = false;
                 break;
             case OS_MACOS: //Mac
                 oled_set_cursor(col,line);
                 oled_write(logo[3][0], false);
                 oled_set_cursor(col,line+1);
                 oled_write(logo[3][1], false);
-                keymap_config.swap_lctl_lgui = true;
-                keymap_config.swap_rctl_rgui = true;
                 break;
             case OS_IOS: //iOS
                 oled_set_cursor(col,line);
                 oled_write(logo[3][0], false);
                 oled_set_cursor(col,line+1);
                 oled_write(logo[3][1], false);
-                keymap_config.swap_lctl_lgui = true;
-                keymap_config.swap_rctl_rgui = true;
                 break;
             default: //OS_UNSURE or not configured
                 oled_set_cursor(col,line);
@@ -476,17 +462,24 @@ void matrix_scan_user(void) { // The very important timer.
     }
 
     bool oled_task_user(void) {
-        render_key_status_or_logo();
-        oled_set_cursor(8,2);
-        render_current_layer();
-        #ifdef DYNAMIC_MACRO_ENABLE
-            render_dynamic_macro_status(18,2);
+        if (oled_dirty & OLED_DIRTY_KEYS) {
+            render_key_status_or_logo();
+        }
+        if (oled_dirty & EVENT_BIT(EVENT_LAYER)) {
+            oled_set_cursor(8,2);
+            render_current_layer();
+        }
+        #ifdef DMACRO_ENABLE
+            if (oled_dirty & OLED_DIRTY_DMACRO) { render_dynamic_macro_status(18,2); }
         #endif
-        oled_set_cursor(8,3);
-        render_current_wpm();
+        if (oled_dirty & EVENT_BIT(EVENT_WPM)) {
+            oled_set_cursor(8,3);
+            render_current_wpm();
+        }
         #ifdef OS_DETECTION_ENABLE
-            if(current_platform != detected_host_os() || rerender_platform) { render_platform_status(3,0); }
+            if(rerender_platform) { render_platform_status(3,0); }
         #endif
+        oled_dirty = 0;
 
         return false;
     }
@@ -6,5 +6,6 @@ ENCODER_MAP_ENABLE = yes
 BOOTMAGIC_ENABLE = yes
 MAGIC_ENABLE = yes
 OS_DETECTION_ENABLE = yes
-DYNAMIC_MACRO_ENABLE = yes
+DMACRO_ENABLE = yes
 CAPS_WORD_ENABLE = yes
+SYNDROME_VIA_CACHE = yes
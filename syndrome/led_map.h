@@ -0,0 +1,43 @@
+// Generated by scripts/gen_led_map.py from keyboard.json, do not edit.
+
+#pragma once
+
+// Nearest LED of every matrix position.
+#define LED_MAP_MATRIX { \
+    {      7,      9,     11,     12,     13, NO_LED, NO_LED, NO_LED }, \
+    {      7,     10,     12,     13,     14, NO_LED, NO_LED, NO_LED }, \
+    {      7,      9,     11,     12,     13, NO_LED, NO_LED, NO_LED }, \
+    {      8,     10,     12,     13,     14, NO_LED, NO_LED, NO_LED }, \
+    {      8,      9,     11,     13,     14, NO_LED, NO_LED, NO_LED }, \
+    {      8,     10,     12,     13,     14, NO_LED, NO_LED, NO_LED }, \
+    {      8,      9, NO_LED,     13,     14, NO_LED, NO_LED, NO_LED }, \
+    {      8,     11,     12,     14,     14, NO_LED, NO_LED, NO_LED }, \
+    { NO_LED, NO_LED, NO_LED, NO_LED, NO_LED,      7,      0,      0 }, \
+    { NO_LED, NO_LED, NO_LED, NO_LED, NO_LED,      1,      0, NO_LED }, \
+}
+
+#define LED_MAP_POINTS { \
+    { 183, 0 }, { 162, 0 }, { 142, 0 }, { 122, 0 }, { 81, 0 }, { 61, 0 }, { 40, 0 }, { 20, 16 }, { 40, 48 }, { 61, 48 }, { 81, 48 }, { 101, 48 }, { 122, 48 }, { 162, 48 }, { 203, 48 }, { 244, 16 } \
+}
+
+#define LED_MAP_FLAGS { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 }
+
+// Distance between two LEDs in the 224x64 space, capped at 255.
+#define LED_MAP_DISTANCES { \
+    {   0,  21,  41,  61, 102, 122, 143, 164, 151, 131, 113,  95,  78,  52,  52,  63 }, \
+    {  21,   0,  20,  40,  81, 101, 122, 143, 131, 112,  94,  78,  62,  48,  63,  84 }, \
+    {  41,  20,   0,  20,  61,  81, 102, 123, 113,  94,  78,  63,  52,  52,  78, 103 }, \
+    {  61,  40,  20,   0,  41,  61,  82, 103,  95,  78,  63,  52,  48,  62,  94, 123 }, \
+    { 102,  81,  61,  41,   0,  20,  41,  63,  63,  52,  48,  52,  63,  94, 131, 164 }, \
+    { 122, 101,  81,  61,  20,   0,  21,  44,  52,  48,  52,  62,  78, 112, 150, 184 }, \
+    { 143, 122, 102,  82,  41,  21,   0,  26,  48,  52,  63,  78,  95, 131, 170, 205 }, \
+    { 164, 143, 123, 103,  63,  44,  26,   0,  38,  52,  69,  87, 107, 146, 186, 224 }, \
+    { 151, 131, 113,  95,  63,  52,  48,  38,   0,  21,  41,  61,  82, 122, 163, 206 }, \
+    { 131, 112,  94,  78,  52,  48,  52,  52,  21,   0,  20,  40,  61, 101, 142, 186 }, \
+    { 113,  94,  78,  63,  48,  52,  63,  69,  41,  20,   0,  20,  41,  81, 122, 166 }, \
+    {  95,  78,  63,  52,  52,  62,  78,  87,  61,  40,  20,   0,  21,  61, 102, 147 }, \
+    {  78,  62,  52,  48,  63,  78,  95, 107,  82,  61,  41,  21,   0,  40,  81, 126 }, \
+    {  52,  48,  52,  62,  94, 112, 131, 146, 122, 101,  81,  61,  40,   0,  41,  88 }, \
+    {  52,  63,  78,  94, 131, 150, 170, 186, 163, 142, 122, 102,  81,  41,   0,  52 }, \
+    {  63,  84, 103, 123, 164, 184, 205, 224, 206, 186, 166, 147, 126,  88,  52,   0 }, \
+}
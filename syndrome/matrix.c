@@ -0,0 +1,469 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Custom matrix scanner.
+ *
+ * The columns are spread over GP2-GP28, so instead of reading them pin by pin
+ * every row is sampled with a single read of the GPIO bank, and the column
+ * bits are gathered with lookup tables built from MATRIX_COL_PINS: one table
+ * per byte of the bank, four lookups per row.
+ *
+ * By default the CPU drives the rows. With `SYNDROME_PIO_MATRIX = yes` in
+ * rules.mk a PIO state machine drives one row low at a time through the pin
+ * directions and samples the bank into the RX FIFO instead. One DMA channel
+ * loops the row select masks into the TX FIFO and another loops the samples
+ * into `row_samples`, so the matrix is scanned continuously without the CPU.
+ *
+ * While the host is suspended, suspend_power_down_kb() calls
+ * matrix_power_down() and the PIO sweep is slowed to
+ * MATRIX_PIO_SUSPEND_SETTLE_US per row until matrix_power_up() on wake.
+ *
+ * With `SYNDROME_SOF_SYNC = yes` scans are also held back until just before
+ * each USB frame, see sof_sync.c.
+ *
+ * With `SYNDROME_ISR_SCAN = yes` the matrix is instead scanned from a
+ * ChibiOS virtual timer every MATRIX_ISR_SCAN_US, whatever the main loop is
+ * doing. Each edge is debounced eagerly there, timestamped and pushed to a
+ * single producer, single consumer ring; matrix_scan_custom() replays the
+ * ring in order, at most one edge per key per call so short taps queued
+ * behind a slow macro are not merged away.
+ *
+ * Only rows and columns that carry a switch in LAYOUT are driven and kept;
+ * the electrical matrix is 10x8 but only 44 positions are populated.
+ *
+ * Apart from the ISR scan, debounce is left to QMK.
+ */
+
+#include QMK_KEYBOARD_H
+#include "matrix.h"
+
+#include "hardware/structs/sio.h"
+
+#ifdef SYNDROME_SOF_SYNC
+#    include "sof_sync.h"
+#endif
+
+#ifdef SYNDROME_ISR_SCAN
+#    include <ch.h>
+#    include "timer_us.h"
+#    ifdef SYNDROME_SOF_SYNC
+#        error "SYNDROME_ISR_SCAN and SYNDROME_SOF_SYNC are mutually exclusive"
+#    endif
+#endif
+
+#ifdef SYNDROME_PIO_MATRIX
+#    include <hal.h>
+#    include "hardware/pio.h"
+#    include "hardware/dma.h"
+#    include "hardware/clocks.h"
+#endif
+
+static const pin_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+static const pin_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+// Positions wired to a switch, taken from LAYOUT so they follow keyboard.json.
+static const uint8_t populated[MATRIX_ROWS][MATRIX_COLS] = LAYOUT(
+    1,                         1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1
+);
+
+// Populated columns of each row, and the rows that have any.
+static matrix_row_t row_masks[MATRIX_ROWS];
+static uint8_t      scan_rows[MATRIX_ROWS];
+static uint8_t      scan_row_count = 0;
+
+static void init_row_masks(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (populated[row][col]) {
+                row_masks[row] |= (matrix_row_t)1 << col;
+            }
+        }
+        if (row_masks[row]) {
+            scan_rows[scan_row_count++] = row;
+        }
+    }
+}
+
+// col_lut[n][b] holds the column bits found in byte n of a GPIO sample.
+static matrix_row_t col_lut[4][256];
+
+static void init_col_lut(void) {
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        uint8_t byte = col_pins[col] / 8;
+        uint8_t bit  = col_pins[col] % 8;
+        for (uint16_t value = 0; value < 256; value++) {
+            if (value & (1 << bit)) {
+                col_lut[byte][value] |= (matrix_row_t)1 << col;
+            }
+        }
+    }
+}
+
+static inline matrix_row_t gather_cols(uint32_t sample) {
+    // Columns are pulled up, a pressed key reads low.
+    uint32_t pressed = ~sample;
+    return col_lut[0][pressed & 0xFF] | col_lut[1][(pressed >> 8) & 0xFF] | col_lut[2][(pressed >> 16) & 0xFF] | col_lut[3][pressed >> 24];
+}
+
+#ifdef SYNDROME_PIO_MATRIX
+
+#ifndef RP_DMA_PRIORITY_MATRIX
+#    define RP_DMA_PRIORITY_MATRIX 12
+#endif
+
+// Time a row is held low before the columns are sampled.
+#ifndef MATRIX_PIO_SETTLE_US
+#    define MATRIX_PIO_SETTLE_US 2
+#endif
+#ifndef MATRIX_PIO_SUSPEND_SETTLE_US
+#    define MATRIX_PIO_SUSPEND_SETTLE_US 500
+#endif
+
+// The scan writes the direction of every pin owned by its PIO block, so it must
+// not share a block with the ws2812 driver.
+#ifndef MATRIX_PIO
+#    ifdef WS2812_PIO_USE_PIO1
+#        define MATRIX_PIO pio0
+#    else
+#        define MATRIX_PIO pio1
+#    endif
+#endif
+
+// DMA ring wrap works on power of two sized, aligned buffers, so the 10 rows
+// take a 16 slot ring. Slots past MATRIX_ROWS select no row and are ignored.
+// That idles 6 of every 16 slots, but a lap is still 16 settle times, about
+// 35 us at MATRIX_PIO_SETTLE_US 2, so the whole matrix is sampled at ~28 kHz.
+// Sizing the ring to the rows would need a third DMA channel to rewind the
+// other two, which is not worth it at that rate.
+#define RING_SLOTS 16
+#define RING_BITS 6 // log2(RING_SLOTS * sizeof(uint32_t))
+
+_Static_assert(MATRIX_ROWS <= RING_SLOTS, "PIO matrix: too many rows for the DMA ring");
+
+static uint32_t          row_selects[RING_SLOTS] __attribute__((aligned(RING_SLOTS * sizeof(uint32_t))));
+static volatile uint32_t row_samples[RING_SLOTS] __attribute__((aligned(RING_SLOTS * sizeof(uint32_t))));
+
+// Both channels move one word per row, so they finish together after a
+// whole number of laps and are simply re-armed.
+#define DMA_TRANSFERS (RING_SLOTS * 0x100000u)
+
+static uint sm;
+static uint dma_tx;
+static uint dma_rx;
+
+// out pindirs, 32 [31] ; pull the selected row low and let it settle
+// in pins, 32          ; sample every GPIO, autopush to the RX FIFO
+static const uint16_t matrix_scan_instructions[] = {
+    0x7f80,
+    0x4000,
+};
+
+static const struct pio_program matrix_scan_program = {
+    .instructions = matrix_scan_instructions,
+    .length       = 2,
+    .origin       = -1,
+};
+
+static void start_dma(void) {
+    dma_channel_set_trans_count(dma_rx, DMA_TRANSFERS, true);
+    dma_channel_set_trans_count(dma_tx, DMA_TRANSFERS, true);
+}
+
+// 32 cycles of settle time per row.
+static float settle_clkdiv(uint32_t settle_us) {
+    return (float)clock_get_hz(clk_sys) * settle_us / 32000000.0f;
+}
+
+static void init_backend(void) {
+    uint32_t row_mask = 0;
+    for (uint8_t i = 0; i < scan_row_count; i++) {
+        uint8_t row      = scan_rows[i];
+        row_selects[row] = 1u << row_pins[row];
+        row_mask |= row_selects[row];
+    }
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        gpio_set_pin_input_high(col_pins[col]);
+    }
+    for (uint8_t slot = 0; slot < RING_SLOTS; slot++) {
+        row_samples[slot] = ~0u;
+    }
+
+    uint offset = pio_add_program(MATRIX_PIO, &matrix_scan_program);
+    sm          = pio_claim_unused_sm(MATRIX_PIO, true);
+
+    // Rows are only ever driven low, so the output latch stays 0 and a row is
+    // selected by making it an output. Writes to pins not handed to the PIO
+    // have no effect. Unselected rows float up on their pull-ups like
+    // unselect_row() leaves them; the pads reset with pull-downs, which would
+    // drag a column through a held key's diode to an undefined level. Pad
+    // pulls are kept across the function select.
+    for (uint8_t i = 0; i < scan_row_count; i++) {
+        gpio_set_pin_input_high(row_pins[scan_rows[i]]);
+        pio_gpio_init(MATRIX_PIO, row_pins[scan_rows[i]]);
+    }
+    pio_sm_set_pins_with_mask(MATRIX_PIO, sm, 0, row_mask);
+    pio_sm_set_pindirs_with_mask(MATRIX_PIO, sm, 0, row_mask);
+
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset, offset + matrix_scan_program.length - 1);
+    sm_config_set_out_pins(&c, 0, 32);
+    sm_config_set_in_pins(&c, 0);
+    sm_config_set_out_shift(&c, true, true, 32);
+    sm_config_set_in_shift(&c, false, true, 32);
+    sm_config_set_clkdiv(&c, settle_clkdiv(MATRIX_PIO_SETTLE_US));
+    pio_sm_init(MATRIX_PIO, sm, offset, &c);
+
+    // Channels come from ChibiOS, which the ws2812 driver allocates from too;
+    // pico-sdk's own claim bitmap is not built into QMK and would not see them.
+    osalSysLock();
+    const rp_dma_channel_t *tx_channel = dmaChannelAllocI(RP_DMA_CHANNEL_ID_ANY, RP_DMA_PRIORITY_MATRIX, NULL, NULL);
+    const rp_dma_channel_t *rx_channel = dmaChannelAllocI(RP_DMA_CHANNEL_ID_ANY, RP_DMA_PRIORITY_MATRIX, NULL, NULL);
+    osalSysUnlock();
+    osalDbgAssert(tx_channel != NULL && rx_channel != NULL, "PIO matrix: no free DMA channel");
+    dma_tx = tx_channel->chnidx;
+    dma_rx = rx_channel->chnidx;
+
+    dma_channel_config tx = dma_channel_get_default_config(dma_tx);
+    channel_config_set_transfer_data_size(&tx, DMA_SIZE_32);
+    channel_config_set_read_increment(&tx, true);
+    channel_config_set_write_increment(&tx, false);
+    channel_config_set_ring(&tx, false, RING_BITS);
+    channel_config_set_dreq(&tx, pio_get_dreq(MATRIX_PIO, sm, true));
+    dma_channel_configure(dma_tx, &tx, &MATRIX_PIO->txf[sm], row_selects, DMA_TRANSFERS, false);
+
+    dma_channel_config rx = dma_channel_get_default_config(dma_rx);
+    channel_config_set_transfer_data_size(&rx, DMA_SIZE_32);
+    channel_config_set_read_increment(&rx, false);
+    channel_config_set_write_increment(&rx, true);
+    channel_config_set_ring(&rx, true, RING_BITS);
+    channel_config_set_dreq(&rx, pio_get_dreq(MATRIX_PIO, sm, false));
+    dma_channel_configure(dma_rx, &rx, row_samples, &MATRIX_PIO->rxf[sm], DMA_TRANSFERS, false);
+
+    start_dma();
+    pio_sm_set_enabled(MATRIX_PIO, sm, true);
+}
+
+static bool scan_backend(matrix_row_t current_matrix[]) {
+    if (!dma_channel_is_busy(dma_rx)) {
+        start_dma();
+    }
+
+    bool changed = false;
+    for (uint8_t i = 0; i < scan_row_count; i++) {
+        uint8_t      row  = scan_rows[i];
+        matrix_row_t cols = gather_cols(row_samples[row]) & row_masks[row];
+        if (current_matrix[row] != cols) {
+            current_matrix[row] = cols;
+            changed             = true;
+        }
+    }
+    return changed;
+}
+
+void matrix_power_up(void) {
+    pio_sm_set_clkdiv(MATRIX_PIO, sm, settle_clkdiv(MATRIX_PIO_SETTLE_US));
+}
+
+void matrix_power_down(void) {
+    pio_sm_set_clkdiv(MATRIX_PIO, sm, settle_clkdiv(MATRIX_PIO_SUSPEND_SETTLE_US));
+}
+
+#else
+
+static void select_row(uint8_t row) {
+    gpio_set_pin_output(row_pins[row]);
+    gpio_write_pin_low(row_pins[row]);
+}
+
+static void unselect_row(uint8_t row) {
+    gpio_set_pin_input_high(row_pins[row]);
+}
+
+static void init_backend(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        unselect_row(row);
+    }
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        gpio_set_pin_input_high(col_pins[col]);
+    }
+}
+
+static bool scan_backend(matrix_row_t current_matrix[]) {
+    bool changed = false;
+    for (uint8_t i = 0; i < scan_row_count; i++) {
+        uint8_t row = scan_rows[i];
+        select_row(row);
+        matrix_output_select_delay();
+        matrix_row_t cols = gather_cols(sio_hw->gpio_in) & row_masks[row];
+        unselect_row(row);
+        matrix_output_unselect_delay(row, cols != 0);
+
+        if (current_matrix[row] != cols) {
+            current_matrix[row] = cols;
+            changed             = true;
+        }
+    }
+    return changed;
+}
+
+#endif
+
+#ifdef SYNDROME_ISR_SCAN
+
+// The ISR only reads the PIO samples, so it is cheap enough to run often.
+#ifndef MATRIX_ISR_SCAN_US
+#    define MATRIX_ISR_SCAN_US 250
+#endif
+// A key is ignored for this long after each edge.
+#ifndef MATRIX_ISR_DEBOUNCE_US
+#    define MATRIX_ISR_DEBOUNCE_US 5000
+#endif
+#ifndef MATRIX_EDGE_RING
+#    define MATRIX_EDGE_RING 64
+#endif
+
+_Static_assert((MATRIX_EDGE_RING & (MATRIX_EDGE_RING - 1)) == 0, "ISR scan: MATRIX_EDGE_RING must be a power of two");
+// Fill level is head - tail in 8 bits, so a ring of 256 would read as empty when full.
+_Static_assert(MATRIX_EDGE_RING < 256, "ISR scan: MATRIX_EDGE_RING indices are 8-bit");
+
+typedef struct {
+    uint32_t time_us;
+    uint8_t  row;
+    uint8_t  col;
+    bool     pressed;
+} key_edge_t;
+
+static key_edge_t       edges[MATRIX_EDGE_RING];
+static volatile uint8_t edge_head = 0; // written by the ISR only
+static volatile uint8_t edge_tail = 0; // written by the main loop only
+
+static virtual_timer_t scan_timer;
+static matrix_row_t    isr_raw[MATRIX_ROWS];     // raw state as last sampled
+static matrix_row_t    isr_settled[MATRIX_ROWS]; // state pushed to the ring
+// Keys inside their debounce window, and when that window opened. The bit
+// is cleared on the first tick past the window rather than comparing against
+// an old deadline later: a 32-bit microsecond deadline reads as in the future
+// again after ~35 minutes idle, which would lock the key out.
+static matrix_row_t    isr_settling[MATRIX_ROWS];
+static uint32_t        accepted_at[MATRIX_ROWS][MATRIX_COLS];
+// Time of the last edge replayed for each key, and which of those have not
+// been claimed by an event yet.
+static uint32_t        edge_time[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t    edge_fresh[MATRIX_ROWS];
+
+static void scan_isr(virtual_timer_t *vtp, void *arg) {
+    (void)vtp;
+    (void)arg;
+    scan_backend(isr_raw);
+    uint32_t now = timer_read_us();
+
+    for (uint8_t i = 0; i < scan_row_count; i++) {
+        uint8_t      row      = scan_rows[i];
+        matrix_row_t settling = isr_settling[row];
+        while (settling) {
+            uint8_t col = __builtin_ctz(settling);
+            settling &= settling - 1;
+            if (now - accepted_at[row][col] >= MATRIX_ISR_DEBOUNCE_US) {
+                isr_settling[row] &= ~((matrix_row_t)1 << col);
+            }
+        }
+
+        matrix_row_t changed = (isr_raw[row] ^ isr_settled[row]) & ~isr_settling[row];
+        while (changed) {
+            uint8_t col = __builtin_ctz(changed);
+            changed &= changed - 1;
+            uint8_t head = edge_head;
+            if ((uint8_t)(head - edge_tail) == MATRIX_EDGE_RING) {
+                return; // Ring full, the edge is picked up again next tick.
+            }
+            bool pressed = isr_raw[row] & ((matrix_row_t)1 << col);
+            edges[head % MATRIX_EDGE_RING] = (key_edge_t){now, row, col, pressed};
+            isr_settled[row] ^= (matrix_row_t)1 << col;
+            isr_settling[row] |= (matrix_row_t)1 << col;
+            accepted_at[row][col] = now;
+            __atomic_store_n(&edge_head, head + 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+bool matrix_take_edge_time_us(uint8_t row, uint8_t col, uint32_t *time_us) {
+    matrix_row_t bit = (matrix_row_t)1 << col;
+    if (!(edge_fresh[row] & bit)) {
+        return false;
+    }
+    edge_fresh[row] &= ~bit;
+    *time_us = edge_time[row][col];
+    return true;
+}
+
+void matrix_init_custom(void) {
+    init_row_masks();
+    init_col_lut();
+    init_backend();
+    chVTObjectInit(&scan_timer);
+    chVTSetContinuous(&scan_timer, TIME_US2I(MATRIX_ISR_SCAN_US), scan_isr, NULL);
+}
+
+bool matrix_scan_custom(matrix_row_t current_matrix[]) {
+    matrix_row_t touched[MATRIX_ROWS] = {0};
+    uint8_t      tail                 = edge_tail;
+    uint8_t      head                 = __atomic_load_n(&edge_head, __ATOMIC_ACQUIRE);
+    bool         changed              = false;
+
+    for (; tail != head; tail++) {
+        const key_edge_t *edge = &edges[tail % MATRIX_EDGE_RING];
+        matrix_row_t      bit  = (matrix_row_t)1 << edge->col;
+        if (touched[edge->row] & bit) {
+            break; // Second edge of a key, leave it for the next pass.
+        }
+        touched[edge->row] |= bit;
+        current_matrix[edge->row] ^= bit;
+        edge_time[edge->row][edge->col] = edge->time_us;
+        edge_fresh[edge->row] |= bit;
+        changed = true;
+    }
+    __atomic_store_n(&edge_tail, tail, __ATOMIC_RELEASE);
+    return changed;
+}
+
+#else
+
+void matrix_init_custom(void) {
+    init_row_masks();
+    init_col_lut();
+    init_backend();
+}
+
+bool matrix_scan_custom(matrix_row_t current_matrix[]) {
+#ifdef SYNDROME_SOF_SYNC
+    if (!sof_sync_scan_due()) {
+        return false;
+    }
+    bool changed = scan_backend(current_matrix);
+    sof_sync_scan_done(changed);
+    return changed;
+#else
+    return scan_backend(current_matrix);
+#endif
+}
+
+#endif
@@ -0,0 +1,224 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quantum.h"
+#include "mouse_engine.h"
+#include "timer_us.h"
+
+_Static_assert(MOUSE_ENGINE_MAX_SPEED <= 6000, "mouse engine: MAX_SPEED too high for 32-bit integration");
+_Static_assert(MOUSE_ENGINE_CURVE >= 1 && MOUSE_ENGINE_CURVE <= 3, "mouse engine: CURVE must be 1, 2 or 3");
+
+// Longest step integrated at once, so a stalled loop cannot fling the pointer.
+#define MAX_STEP_US 10000
+
+// 181/256 ~ 1/sqrt(2), keeps diagonal speed equal to straight speed.
+#define DIAGONAL_SCALE 181
+
+enum {
+    DIR_UP,
+    DIR_DOWN,
+    DIR_LEFT,
+    DIR_RIGHT,
+    WHEEL_UP,
+    WHEEL_DOWN,
+    WHEEL_LEFT,
+    WHEEL_RIGHT,
+};
+
+#define POINTER_MASK 0x0F
+#define WHEEL_MASK 0xF0
+
+static uint8_t held         = 0;
+static uint8_t buttons      = 0;
+static uint8_t accel_held   = 0;
+static bool    dirty        = false;
+static uint32_t pointer_start = 0;
+static uint32_t wheel_start   = 0;
+static uint32_t last_report   = 0;
+
+// 16.16 fixed point pixels and wheel steps not yet sent.
+static int32_t acc_x = 0;
+static int32_t acc_y = 0;
+static int32_t acc_v = 0;
+static int32_t acc_h = 0;
+
+static int8_t axis(uint8_t positive, uint8_t negative) {
+    return ((held >> positive) & 1) - ((held >> negative) & 1);
+}
+
+// Pointer speed in 16.16 pixels per millisecond, `held_us` into a press.
+static uint32_t pointer_speed(uint32_t held_us) {
+    uint32_t speed;
+    if (accel_held) {
+        speed = accel_held & 4 ? MOUSE_ENGINE_MAX_SPEED : accel_held & 2 ? MOUSE_ENGINE_MAX_SPEED / 2 : MOUSE_ENGINE_MAX_SPEED / 4;
+    } else if (held_us < MOUSE_ENGINE_DELAY_MS * 1000) {
+        return 0;
+    } else {
+        // Ramp position 0..256 along the curve.
+        uint32_t ramp = (held_us - MOUSE_ENGINE_DELAY_MS * 1000) / MOUSE_ENGINE_TIME_TO_MAX_MS;
+        ramp          = ramp * 256 / 1000;
+        if (ramp > 256) {
+            ramp = 256;
+        }
+        uint32_t linear = ramp;
+#if MOUSE_ENGINE_CURVE >= 2
+        ramp = ramp * linear / 256;
+#endif
+#if MOUSE_ENGINE_CURVE == 3
+        ramp = ramp * linear / 256;
+#endif
+        speed = MOUSE_ENGINE_MIN_SPEED + (MOUSE_ENGINE_MAX_SPEED - MOUSE_ENGINE_MIN_SPEED) * ramp / 256;
+    }
+    return speed * 65536 / 1000;
+}
+
+static int8_t take(int32_t *acc) {
+    int32_t whole = *acc / 65536;
+    if (whole > 127) {
+        whole = 127;
+    } else if (whole < -127) {
+        whole = -127;
+    }
+    *acc -= whole * 65536;
+    return whole;
+}
+
+static void integrate(uint32_t now, uint32_t step_us) {
+    int8_t dx = axis(DIR_RIGHT, DIR_LEFT);
+    int8_t dy = axis(DIR_DOWN, DIR_UP);
+    if (dx || dy) {
+        uint32_t delta = pointer_speed(now - pointer_start) * step_us / 1000;
+        if (dx && dy) {
+            delta = delta * DIAGONAL_SCALE / 256;
+        }
+        acc_x += dx * (int32_t)delta;
+        acc_y += dy * (int32_t)delta;
+    }
+
+    int8_t dv = axis(WHEEL_UP, WHEEL_DOWN);
+    int8_t dh = axis(WHEEL_RIGHT, WHEEL_LEFT);
+    if ((dv || dh) && now - wheel_start >= MOUSE_ENGINE_WHEEL_DELAY_MS * 1000) {
+        uint32_t delta = MOUSE_ENGINE_WHEEL_SPEED * 65536 / 1000 * step_us / 1000;
+        acc_v += dv * (int32_t)delta;
+        acc_h += dh * (int32_t)delta;
+    }
+}
+
+static void send_report(void) {
+    report_mouse_t report = {
+        .buttons = buttons,
+        .x       = take(&acc_x),
+        .y       = take(&acc_y),
+        .v       = take(&acc_v),
+        .h       = take(&acc_h),
+    };
+    if (report.x || report.y || report.v || report.h || dirty) {
+        host_mouse_send(&report);
+        dirty = false;
+    }
+}
+
+void mouse_engine_task(void) {
+    if (!held && !dirty) {
+        return;
+    }
+    uint32_t now  = timer_read_us();
+    uint32_t step = now - last_report;
+    if (step < MOUSE_ENGINE_INTERVAL_US) {
+        return;
+    }
+    last_report = now;
+    integrate(now, step > MAX_STEP_US ? MAX_STEP_US : step);
+    send_report();
+}
+
+static void press_direction(uint8_t dir, bool pressed) {
+    uint8_t bit = 1 << dir;
+    if (!pressed) {
+        held &= ~bit;
+        // Drop leftover fractions once an axis stops, so the next press starts clean.
+        if (!(held & POINTER_MASK)) {
+            acc_x = acc_y = 0;
+        }
+        if (!(held & WHEEL_MASK)) {
+            acc_v = acc_h = 0;
+        }
+        return;
+    }
+
+    uint32_t now = timer_read_us();
+    if (bit & POINTER_MASK) {
+        if (!(held & POINTER_MASK)) {
+            pointer_start = now;
+        }
+    } else if (!(held & WHEEL_MASK)) {
+        wheel_start = now;
+    }
+    if (!held) {
+        last_report = now;
+    }
+    held |= bit;
+
+    // The first pixel or wheel step goes out at once.
+    int32_t *acc = dir == DIR_UP || dir == DIR_DOWN ? &acc_y : dir == DIR_LEFT || dir == DIR_RIGHT ? &acc_x : dir == WHEEL_UP || dir == WHEEL_DOWN ? &acc_v : &acc_h;
+    *acc += dir == DIR_UP || dir == DIR_LEFT || dir == WHEEL_DOWN || dir == WHEEL_LEFT ? -65536 : 65536;
+    dirty = true;
+    send_report();
+}
+
+bool process_mouse_engine(uint16_t keycode, keyrecord_t *record) {
+    bool pressed = record->event.pressed;
+    switch (keycode) {
+        case MS_UP:
+            press_direction(DIR_UP, pressed);
+            return false;
+        case MS_DOWN:
+            press_direction(DIR_DOWN, pressed);
+            return false;
+        case MS_LEFT:
+            press_direction(DIR_LEFT, pressed);
+            return false;
+        case MS_RGHT:
+            press_direction(DIR_RIGHT, pressed);
+            return false;
+        case MS_WHLU:
+            press_direction(WHEEL_UP, pressed);
+            return false;
+        case MS_WHLD:
+            press_direction(WHEEL_DOWN, pressed);
+            return false;
+        case MS_WHLL:
+            press_direction(WHEEL_LEFT, pressed);
+            return false;
+        case MS_WHLR:
+            press_direction(WHEEL_RIGHT, pressed);
+            return false;
+        case MS_BTN1 ... MS_BTN8: {
+            uint8_t bit = 1 << (keycode - MS_BTN1);
+            buttons     = pressed ? buttons | bit : buttons & ~bit;
+            dirty       = true;
+            send_report();
+            return false;
+        }
+        case MS_ACL0 ... MS_ACL2: {
+            uint8_t bit = 1 << (keycode - MS_ACL0);
+            accel_held  = pressed ? accel_held | bit : accel_held & ~bit;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "action.h"
+
+/*
+ * Mouse keys engine.
+ *
+ * Replaces QMK's mouse keys for the MS_* keycodes. Pointer and wheel speeds
+ * are integrated into 16.16 fixed point accumulators every report interval,
+ * so sub-pixel motion carries over instead of being rounded away, and both
+ * are sent in the same report.
+ *
+ * A press moves one pixel (or wheel step) at once. After the delay the speed
+ * ramps from MIN to MAX over TIME_TO_MAX along the configured curve. The
+ * MS_ACL0/1/2 keys hold a quarter, half or full MAX speed while pressed.
+ */
+
+// Time between reports. 1000 us matches a 1 kHz USB poll.
+#ifndef MOUSE_ENGINE_INTERVAL_US
+#    define MOUSE_ENGINE_INTERVAL_US 1000
+#endif
+
+// Pointer, in pixels per second.
+#ifndef MOUSE_ENGINE_DELAY_MS
+#    define MOUSE_ENGINE_DELAY_MS 150
+#endif
+#ifndef MOUSE_ENGINE_MIN_SPEED
+#    define MOUSE_ENGINE_MIN_SPEED 100
+#endif
+#ifndef MOUSE_ENGINE_MAX_SPEED
+#    define MOUSE_ENGINE_MAX_SPEED 1600
+#endif
+#ifndef MOUSE_ENGINE_TIME_TO_MAX_MS
+#    define MOUSE_ENGINE_TIME_TO_MAX_MS 1000
+#endif
+
+// Shape of the ramp: 1 is linear, 2 quadratic, 3 cubic.
+#ifndef MOUSE_ENGINE_CURVE
+#    define MOUSE_ENGINE_CURVE 2
+#endif
+
+// Wheel, in steps per second.
+#ifndef MOUSE_ENGINE_WHEEL_DELAY_MS
+#    define MOUSE_ENGINE_WHEEL_DELAY_MS 200
+#endif
+#ifndef MOUSE_ENGINE_WHEEL_SPEED
+#    define MOUSE_ENGINE_WHEEL_SPEED 20
+#endif
+
+bool process_mouse_engine(uint16_t keycode, keyrecord_t *record);
+void mouse_engine_task(void);
@@ -0,0 +1,50 @@
+ifeq ($(strip $(DMACRO_ENABLE)), yes)
+    SRC += dmacro.c
+    OPT_DEFS += -DDMACRO_ENABLE
+endif
+
+ifeq ($(strip $(SYNDROME_ISR_SCAN)), yes)
+    # The ISR only reads the samples the PIO scan leaves in RAM.
+    SYNDROME_PIO_MATRIX = yes
+    OPT_DEFS += -DSYNDROME_ISR_SCAN
+endif
+
+ifeq ($(strip $(SYNDROME_PIO_MATRIX)), yes)
+    OPT_DEFS += -DSYNDROME_PIO_MATRIX
+endif
+
+ifeq ($(strip $(SYNDROME_SOF_SYNC)), yes)
+    SRC += sof_sync.c
+    OPT_DEFS += -DSYNDROME_SOF_SYNC
+endif
+
+ifeq ($(strip $(SPARSE_KEYMAP_ENABLE)), yes)
+    # Regenerates sparse_keymap.h from keymap.c; it is only rewritten on change.
+    $(shell python3 $(dir $(lastword $(MAKEFILE_LIST)))scripts/gen_sparse_keymap.py $(KEYMAP_PATH))
+    SRC += sparse_keymap.c
+endif
+
+ifeq ($(strip $(LEADER_ENABLE)), yes)
+    ifneq ($(wildcard $(KEYMAP_PATH)/leader.json),)
+        # Regenerates leader_trie.h from leader.json; it is only rewritten on change.
+        $(shell python3 $(dir $(lastword $(MAKEFILE_LIST)))scripts/gen_leader_trie.py $(KEYMAP_PATH))
+    endif
+endif
+
+ifeq ($(strip $(SYNDROME_MOUSE_ENGINE)), yes)
+    MOUSE_ENABLE = yes
+    SRC += mouse_engine.c
+    OPT_DEFS += -DSYNDROME_MOUSE_ENGINE
+endif
+
+ifeq ($(strip $(SYNDROME_VIA_CACHE)), yes)
+    SRC += via_cache.c
+    OPT_DEFS += -DSYNDROME_VIA_CACHE
+endif
+
+ifeq ($(strip $(SYNDROME_BUDGET)), yes)
+    # Per-function stack frame sizes for scripts/budget_report.py. LTO emits
+    # them from the link instead of next to each object, so turn it off.
+    EXTRAFLAGS += -fstack-usage
+    LTO_ENABLE = no
+endif
@@ -0,0 +1,177 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quantum.h"
+#include "rgb_effects.h"
+#include "led_map.h"
+
+_Static_assert(RGB_MATRIX_LED_COUNT <= 32, "rgb effects: the active mask holds 32 LEDs");
+
+static const uint8_t led_distance[RGB_MATRIX_LED_COUNT][RGB_MATRIX_LED_COUNT] = LED_MAP_DISTANCES;
+
+static uint16_t heat[RGB_MATRIX_LED_COUNT];
+static uint32_t active     = 0;
+static uint32_t last_step  = 0;
+static bool     drawn_dark = false;
+
+static void add_heat(uint8_t led, uint16_t amount) {
+    heat[led] = heat[led] > UINT16_MAX - amount ? UINT16_MAX : heat[led] + amount;
+    active |= 1u << led;
+}
+
+// Removes 1/16 of the heat of every active LED per elapsed step.
+static void decay(uint16_t step_ms) {
+    uint16_t steps = timer_elapsed32(last_step) / step_ms;
+    if (!steps) {
+        return;
+    }
+    last_step += steps * step_ms;
+    for (uint32_t mask = active; mask; mask &= mask - 1) {
+        uint8_t led = __builtin_ctz(mask);
+        for (uint16_t i = 0; i < steps && heat[led]; i++) {
+            heat[led] -= (heat[led] >> 4) + 1;
+        }
+        if (heat[led] < 0x100) {
+            heat[led] = 0;
+            active &= ~(1u << led);
+        }
+    }
+}
+
+// Once a whole frame has been drawn with no heat left, later frames are skipped
+// until something heats up again.
+static bool skip_dark_frame(effect_params_t *params) {
+    if (active || params->init) {
+        drawn_dark = false;
+    }
+    return drawn_dark;
+}
+
+static bool finish_frame(uint8_t led_max) {
+    if (!active && led_max >= RGB_MATRIX_LED_COUNT) {
+        drawn_dark = true;
+    }
+    return rgb_matrix_check_finished_leds(led_max);
+}
+
+void rgb_heatmap_hit(uint8_t row, uint8_t col) {
+    uint8_t hit = g_led_config.matrix_co[row][col];
+    if (hit == NO_LED) {
+        return;
+    }
+    if (!active) {
+        last_step = timer_read32();
+    }
+    for (uint8_t led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        uint8_t distance = led_distance[hit][led];
+        if (distance < RGB_HEATMAP_SPREAD) {
+            add_heat(led, (uint16_t)RGB_HEATMAP_HIT * (RGB_HEATMAP_SPREAD - distance) / RGB_HEATMAP_SPREAD << 8);
+        }
+    }
+}
+
+bool rgb_heatmap_render(effect_params_t *params) {
+    if (params->init) {
+        memset(heat, 0, sizeof(heat));
+        active = 0;
+    }
+    if (params->iter == 0) {
+        decay(RGB_HEATMAP_DECAY_MS);
+    }
+    if (skip_dark_frame(params)) {
+        return rgb_matrix_check_finished_leds(RGB_MATRIX_LED_COUNT);
+    }
+
+    RGB_MATRIX_USE_LIMITS(led_min, led_max);
+    for (uint8_t i = led_min; i < led_max; i++) {
+        RGB_MATRIX_TEST_LED_FLAGS();
+        uint8_t val = heat[i] >> 8;
+        hsv_t   hsv = {170 - qsub8(val, 85), rgb_matrix_config.hsv.s, scale8((qadd8(170, val) - 170) * 3, rgb_matrix_config.hsv.v)};
+        rgb_t   rgb = rgb_matrix_hsv_to_rgb(hsv);
+        rgb_matrix_set_color(i, rgb.r, rgb.g, rgb.b);
+    }
+    return finish_frame(led_max);
+}
+
+// LED each drop falls to: the nearest LED lower on the board, if any.
+static uint8_t below[RGB_MATRIX_LED_COUNT];
+static uint32_t drops    = 0;
+static uint32_t top_leds = 0;
+
+static void init_rain(void) {
+    top_leds = 0;
+    for (uint8_t led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        below[led]         = NO_LED;
+        uint8_t best       = UINT8_MAX;
+        bool    has_higher = false;
+        for (uint8_t other = 0; other < RGB_MATRIX_LED_COUNT; other++) {
+            if (g_led_config.point[other].y > g_led_config.point[led].y && led_distance[led][other] < best) {
+                best       = led_distance[led][other];
+                below[led] = other;
+            }
+            has_higher |= g_led_config.point[other].y < g_led_config.point[led].y;
+        }
+        if (!has_higher) {
+            top_leds |= 1u << led;
+        }
+    }
+    drops = 0;
+}
+
+bool rgb_rain_render(effect_params_t *params) {
+    if (params->init) {
+        memset(heat, 0, sizeof(heat));
+        active    = 0;
+        last_step = timer_read32();
+        init_rain();
+    }
+    if (params->iter == 0 && timer_elapsed32(last_step) >= RGB_RAIN_STEP_MS) {
+        uint32_t fallen = 0;
+        for (uint32_t mask = drops; mask; mask &= mask - 1) {
+            uint8_t next = below[__builtin_ctz(mask)];
+            if (next != NO_LED) {
+                fallen |= 1u << next;
+            }
+        }
+        drops = fallen;
+        if (top_leds && rand() % RGB_RAIN_CHANCE == 0) {
+            uint8_t start = rand() % RGB_MATRIX_LED_COUNT;
+            while (!(top_leds & (1u << start))) {
+                start = (start + 1) % RGB_MATRIX_LED_COUNT;
+            }
+            drops |= 1u << start;
+        }
+        // Trails fade out behind the drops.
+        decay(RGB_RAIN_STEP_MS);
+        for (uint32_t mask = drops; mask; mask &= mask - 1) {
+            uint8_t led = __builtin_ctz(mask);
+            heat[led]   = UINT16_MAX;
+            active |= 1u << led;
+        }
+    }
+    if (skip_dark_frame(params)) {
+        return rgb_matrix_check_finished_leds(RGB_MATRIX_LED_COUNT);
+    }
+
+    RGB_MATRIX_USE_LIMITS(led_min, led_max);
+    for (uint8_t i = led_min; i < led_max; i++) {
+        RGB_MATRIX_TEST_LED_FLAGS();
+        uint8_t val = scale8(heat[i] >> 8, rgb_matrix_config.hsv.v);
+        rgb_matrix_set_color(i, val / 4, val, val / 4);
+    }
+    return finish_frame(led_max);
+}
@@ -0,0 +1,55 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "rgb_matrix.h"
+
+/*
+ * LED-indexed state for the heatmap and rain effects in rgb_matrix_kb.inc.
+ *
+ * They replace the core typing_heatmap and digital_rain, whose framebuffer is
+ * one byte per matrix position (80) for 16 LEDs. Here heat is kept per LED in
+ * 8.8 fixed point, only LEDs in the active mask are decayed or drawn, and a
+ * frame with no heat left is skipped.
+ */
+
+// Heat added to the LED under a pressed key, and spread to LEDs within range.
+#ifndef RGB_HEATMAP_HIT
+#    define RGB_HEATMAP_HIT 48
+#endif
+#ifndef RGB_HEATMAP_SPREAD
+#    define RGB_HEATMAP_SPREAD 45
+#endif
+// Each step removes 1/16 of the remaining heat.
+#ifndef RGB_HEATMAP_DECAY_MS
+#    define RGB_HEATMAP_DECAY_MS 50
+#endif
+
+// A drop moves one LED down per step; a new one starts 1 step in RGB_RAIN_CHANCE.
+#ifndef RGB_RAIN_STEP_MS
+#    define RGB_RAIN_STEP_MS 120
+#endif
+#ifndef RGB_RAIN_CHANCE
+#    define RGB_RAIN_CHANCE 3
+#endif
+
+void rgb_heatmap_hit(uint8_t row, uint8_t col);
+bool rgb_heatmap_render(effect_params_t *params);
+bool rgb_rain_render(effect_params_t *params);
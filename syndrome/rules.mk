@@ -2,3 +2,15 @@
 OLED_DRIVER = ssd1306
 
 OPT_DEFS += -DHAL_USE_I2C=TRUE
+
+CUSTOM_MATRIX = lite
+SRC += matrix.c
+
+SRC += send_string_batch.c
+SRC += defer.c
+SRC += events.c
+SRC += wpm.c
+SRC += fingers.c
+
+RGB_MATRIX_CUSTOM_KB = yes
+SRC += rgb_effects.c
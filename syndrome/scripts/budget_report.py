@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Report flash, static RAM and stack use per feature and source file.
+
+Each argument names a keymap and its firmware ELF from the QMK build:
+
+    budget_report.py default=.build/syndrome_default.elf \\
+                     sherman=.build/syndrome_sherman.elf \\
+                     vial=.build/syndrome_vial.elf
+
+Symbol sizes and their source files come from `nm -S -l`, so the build needs
+debug info (QMK's default). Symbols are grouped into features by the path of
+the file that defines them, see FEATURES. Stack is the largest single frame
+per feature from the compiler's .su files, which SYNDROME_BUDGET = yes in
+rules.mk turns on (with LTO off); it is a frame size, not a call chain depth.
+A build without them shows '-' for stack.
+
+    --files        also list the largest source files of every keymap
+    --save FILE    write the per-feature totals to FILE as JSON
+    --compare FILE print the change from totals saved by an earlier build
+
+Set NM to use another nm than arm-none-eabi-nm.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+from collections import defaultdict
+from pathlib import Path
+
+# First match on the source path wins.
+FEATURES = [
+    ('achordion', 'features/achordion'),
+    ('sparse keymap', 'sparse_keymap'),
+    ('keymap', '/keymaps/'),
+    ('dmacro', 'dmacro'),
+    ('mouse', 'mouse'),
+    ('rgb effects', 'rgb_effects'),
+    ('rgb matrix', 'rgb_matrix'),
+    ('ws2812', 'ws2812'),
+    ('oled', 'oled'),
+    ('vial', 'vial'),
+    ('via', '/via'),
+    ('dynamic keymap', 'dynamic_keymap'),
+    ('combo', 'process_combo'),
+    ('caps word', 'caps_word'),
+    ('os detection', 'os_detection'),
+    ('encoder', 'encoder'),
+    ('board', '/syndrome/'),
+    ('usb', 'usb'),
+    ('chibios', 'chibios'),
+    ('quantum', 'quantum/'),
+    ('tmk', 'tmk_core/'),
+]
+
+FLASH_TYPES = set('TtRrWwVv')
+DATA_TYPES = set('Dd')
+BSS_TYPES = set('BbCc')
+
+
+def feature_of(path):
+    path = path.replace('\\', '/')
+    for name, pattern in FEATURES:
+        if pattern in path:
+            return name
+    return 'other'
+
+
+def read_symbols(elf):
+    nm = os.environ.get('NM', 'arm-none-eabi-nm')
+    out = subprocess.run([nm, '-S', '-l', '--size-sort', str(elf)],
+                         check=True, capture_output=True, text=True).stdout
+    for line in out.splitlines():
+        fields, _, location = line.partition('\t')
+        parts = fields.split()
+        if len(parts) != 4:
+            continue
+        size, kind = int(parts[1], 16), parts[2]
+        path = location.rsplit(':', 1)[0] if location else '(no debug info)'
+        yield path, kind, size
+
+
+def read_stack(elf):
+    # QMK puts objects in .build/obj_<target>/ next to the ELF.
+    obj_dir = elf.parent / f'obj_{elf.stem}'
+    for su in obj_dir.rglob('*.su'):
+        for line in su.read_text().splitlines():
+            where, size, _ = line.split('\t')
+            yield where.split(':')[0], where.rsplit(':', 1)[-1], int(size)
+
+
+def measure(elf):
+    files = defaultdict(lambda: {'flash': 0, 'ram': 0})
+    for path, kind, size in read_symbols(elf):
+        if kind in FLASH_TYPES:
+            files[path]['flash'] += size
+        elif kind in DATA_TYPES:
+            files[path]['flash'] += size
+            files[path]['ram'] += size
+        elif kind in BSS_TYPES:
+            files[path]['ram'] += size
+
+    features = defaultdict(lambda: {'flash': 0, 'ram': 0, 'stack': None, 'deepest': ''})
+    for path, use in files.items():
+        feature = features[feature_of(path)]
+        feature['flash'] += use['flash']
+        feature['ram'] += use['ram']
+    stack = list(read_stack(elf))
+    if not stack:
+        print(f'{elf}: no .su files, no stack data (build with SYNDROME_BUDGET = yes)')
+    for path, function, size in stack:
+        feature = features[feature_of(path)]
+        if feature['stack'] is None or size > feature['stack']:
+            feature['stack'] = size
+            feature['deepest'] = function
+    return dict(files), dict(features)
+
+
+def print_features(results, baseline):
+    names = list(results)
+    print(f'{"feature":<16}' + ''.join(f'{name + " flash":>16}{"ram":>8}{"stack":>7}' for name in names))
+    features = sorted({f for _, per_feature in results.values() for f in per_feature},
+                      key=lambda f: -max(results[n][1].get(f, {}).get('flash', 0) for n in names))
+    for feature in features + ['total']:
+        row = f'{feature:<16}'
+        for name in names:
+            per_feature = results[name][1]
+            if feature == 'total':
+                use = {key: sum(u[key] for u in per_feature.values()) for key in ('flash', 'ram')}
+                use['stack'] = max((u['stack'] for u in per_feature.values() if u['stack'] is not None), default=None)
+            else:
+                use = per_feature.get(feature, {'flash': 0, 'ram': 0, 'stack': None})
+            old = baseline.get(name, {}).get(feature) if baseline else None
+            stack = '-' if use['stack'] is None else use['stack']
+            row += f'{use["flash"]:>10}{delta(use, old, "flash"):>6}{use["ram"]:>8}{stack:>7}'
+        print(row)
+
+
+def delta(use, old, key):
+    if old is None:
+        return ''
+    change = use[key] - old[key]
+    return f'{change:+d}' if change else ''
+
+
+def print_files(name, files, count=15):
+    print(f'\n{name}: largest source files')
+    for path, use in sorted(files.items(), key=lambda item: -item[1]['flash'])[:count]:
+        print(f'{use["flash"]:>8} {use["ram"]:>6}  {path}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('builds', nargs='+', metavar='KEYMAP=ELF')
+    parser.add_argument('--files', action='store_true')
+    parser.add_argument('--save', type=Path)
+    parser.add_argument('--compare', type=Path)
+    args = parser.parse_args()
+
+    results = {}
+    for build in args.builds:
+        name, _, elf = build.partition('=')
+        results[name] = measure(Path(elf))
+
+    baseline = json.loads(args.compare.read_text()) if args.compare else None
+    print_features(results, baseline)
+    if args.files:
+        for name, (files, _) in results.items():
+            print_files(name, files)
+    if args.save:
+        totals = {}
+        for name, (_, per_feature) in results.items():
+            totals[name] = per_feature
+            totals[name]['total'] = {key: sum(u[key] for u in per_feature.values()) for key in ('flash', 'ram')}
+        args.save.write_text(json.dumps(totals, indent=2) + '\n')
+
+
+if __name__ == '__main__':
+    main()
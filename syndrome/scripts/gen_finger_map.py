@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Generate finger_map.h, the hand, finger and row of every key.
+
+The matrix wiring says nothing about where a key sits, so the model is read
+off the LAYOUT x/y coordinates in keyboard.json instead:
+
+  * the hand is the side of the board the key centre is on;
+  * in the alpha rows (ten or more keys) fingers are assigned by position from
+    the outside in, pinky, ring, middle and two index columns per hand, with
+    anything past the tenth key going to the right pinky;
+  * keys on the bottom row are thumbs;
+  * other keys take the finger of the alpha key closest in x on the nearest
+    alpha row;
+  * the row counts physical rows from the top.
+
+    gen_finger_map.py
+
+writes finger_map.h next to keyboard.json. Rerun it when the layout changes.
+"""
+
+import json
+from pathlib import Path
+
+KEYBOARD_DIR = Path(__file__).resolve().parent.parent
+
+FINGERS = ['PINKY', 'RING', 'MIDDLE', 'INDEX', 'INDEX',
+           'INDEX', 'INDEX', 'MIDDLE', 'RING', 'PINKY']
+
+
+def centre(key):
+    return key['x'] + key.get('w', 1) / 2
+
+
+def main():
+    info = json.loads((KEYBOARD_DIR / 'keyboard.json').read_text())
+    rows = len(info['matrix_pins']['rows'])
+    cols = len(info['matrix_pins']['cols'])
+    keys = info['layouts']['LAYOUT']['layout']
+
+    width = max(key['x'] + key.get('w', 1) for key in keys)
+    ys = sorted({key['y'] for key in keys})
+    by_row = {y: sorted((key for key in keys if key['y'] == y), key=centre) for y in ys}
+    alpha_rows = [y for y in ys if len(by_row[y]) >= len(FINGERS)]
+
+    finger = {}
+    for y in alpha_rows:
+        for i, key in enumerate(by_row[y]):
+            finger[id(key)] = FINGERS[min(i, len(FINGERS) - 1)]
+    for y in ys:
+        if y in alpha_rows:
+            continue
+        for key in by_row[y]:
+            if y == ys[-1]:
+                finger[id(key)] = 'THUMB'
+                continue
+            nearest_row = by_row[min(alpha_rows, key=lambda a: abs(a - y))]
+            nearest = min(nearest_row, key=lambda other: abs(centre(other) - centre(key)))
+            finger[id(key)] = finger[id(nearest)]
+
+    matrix = [['FINGER_NONE'] * cols for _ in range(rows)]
+    for key in keys:
+        hand = 'LEFT' if centre(key) < width / 2 else 'RIGHT'
+        row, col = key['matrix']
+        matrix[row][col] = f'FM({hand}, {finger[id(key)]}, {ys.index(key["y"])})'
+
+    cell = max(len(entry) for line in matrix for entry in line)
+    out = [
+        '// Generated by scripts/gen_finger_map.py from keyboard.json, do not edit.',
+        '',
+        '#pragma once',
+        '',
+        '// Hand, finger and physical row of every matrix position, see fingers.h.',
+        '#define FINGER_MAP { \\',
+    ]
+    out += ['    { ' + ', '.join(f'{entry:>{cell}}' for entry in line) + ' }, \\' for line in matrix]
+    out.append('}')
+    out.append('')
+    (KEYBOARD_DIR / 'finger_map.h').write_text('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
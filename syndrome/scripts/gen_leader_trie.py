@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Generate a keymap's leader sequence trie from its leader.json.
+
+leader.json maps each sequence, keys separated by spaces without the KC_
+prefix, to the snippet enum value keymap.c sends for it:
+
+    { "P A": "SNIP_PARENS", "B B I": "SNIP_BRACKETS" }
+
+A sequence may be a prefix of a longer one; its snippet is then sent when
+the leader times out after it. Nodes are stored breadth first with each
+node's children next to each other, in the order the sequences are listed,
+so a lookup only scans the children of the current node.
+
+    gen_leader_trie.py keyboards/syndrome/keymaps/sherman
+
+writes leader_trie.h next to keymap.c. The header is only rewritten when
+its contents change, so it is safe to run on every build.
+"""
+
+import json
+import sys
+from pathlib import Path
+
+
+class Node:
+    def __init__(self, key):
+        self.key = key
+        self.children = []
+        self.snippet = None
+        self.index = 0
+
+    def child(self, key):
+        for node in self.children:
+            if node.key == key:
+                return node
+        node = Node(key)
+        self.children.append(node)
+        return node
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(f'usage: {sys.argv[0]} <keymap dir>')
+    keymap_dir = Path(sys.argv[1])
+    # Pairs rather than a dict, so a sequence listed twice is not merged away.
+    sequences = json.loads((keymap_dir / 'leader.json').read_text(), object_pairs_hook=list)
+
+    root = Node(None)
+    for sequence, snippet in sequences:
+        keys = sequence.split()
+        if not keys:
+            sys.exit('leader.json: empty sequence')
+        node = root
+        for key in keys:
+            node = node.child(key)
+        if node.snippet:
+            sys.exit(f'leader.json: "{sequence}" is listed twice')
+        node.snippet = snippet
+
+    # Breadth first: a node's children are numbered together, after every
+    # node of the level above.
+    order, queue = [root], [root]
+    while queue:
+        node = queue.pop(0)
+        for child in node.children:
+            child.index = len(order)
+            order.append(child)
+        queue.extend(node.children)
+    if len(order) > 255:
+        sys.exit('leader.json: more than 255 trie nodes')
+
+    paths = {id(root): 'root'}
+    for node in order:
+        for child in node.children:
+            paths[id(child)] = (paths[id(node)] + ' ' + child.key).removeprefix('root ')
+
+    width = max(len(paths[id(node)]) for node in order)
+    out = [
+        '// Generated by scripts/gen_leader_trie.py from leader.json, do not edit.',
+        '',
+        '#pragma once',
+        '',
+        '// { keycode, first child, child count, snippet }, breadth first.',
+        '#define LEADER_TRIE { \\',
+    ]
+    for i, node in enumerate(order):
+        keycode = f'KC_{node.key}' if node.key else 'KC_NO'
+        first = node.children[0].index if node.children else 0
+        snippet = node.snippet or 'SNIP_NONE'
+        out.append(f'    /* {i:>2} {paths[id(node)]:<{width}} */ {{ {keycode}, {first}, {len(node.children)}, {snippet} }}, \\')
+    out.append('}')
+    out.append('')
+
+    header = keymap_dir / 'leader_trie.h'
+    text = '\n'.join(out)
+    if not header.exists() or header.read_text() != text:
+        header.write_text(text)
+
+
+if __name__ == '__main__':
+    main()
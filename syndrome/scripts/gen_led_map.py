@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Generate led_map.h, the key to LED association for rgb_matrix.
+
+The 16 LEDs are not under individual keys, so every wired matrix position is
+given its nearest LED, measured from the key centres in keyboard.json scaled
+into the 224x64 rgb_matrix space. Unwired positions get NO_LED. The header
+also carries the LED to LED distances for reactive effects.
+
+    gen_led_map.py
+
+writes led_map.h next to keyboard.json. Rerun it when the layout or the LED
+positions below change.
+"""
+
+import json
+import math
+from pathlib import Path
+
+KEYBOARD_DIR = Path(__file__).resolve().parent.parent
+
+# Physical LED positions in the 224x64 rgb_matrix space, in chain order.
+LED_POINTS = [
+    (183, 0), (162, 0), (142, 0), (122, 0), (81, 0), (61, 0), (40, 0),
+    (20, 16), (40, 48),
+    (61, 48), (81, 48), (101, 48), (122, 48), (162, 48), (203, 48), (244, 16),
+]
+LED_FLAGS = [1] * len(LED_POINTS)  # LED_FLAG_ALL
+
+
+def main():
+    info = json.loads((KEYBOARD_DIR / 'keyboard.json').read_text())
+    rows = len(info['matrix_pins']['rows'])
+    cols = len(info['matrix_pins']['cols'])
+    keys = info['layouts']['LAYOUT']['layout']
+    if len(LED_POINTS) != info['rgb_matrix']['led_count']:
+        raise SystemExit('LED_POINTS does not match rgb_matrix.led_count')
+
+    width = max(key['x'] + key.get('w', 1) for key in keys)
+    height = max(key['y'] + key.get('h', 1) for key in keys)
+
+    matrix = [['NO_LED'] * cols for _ in range(rows)]
+    for key in keys:
+        x = (key['x'] + key.get('w', 1) / 2) * 224 / width
+        y = (key['y'] + key.get('h', 1) / 2) * 64 / height
+        nearest = min(range(len(LED_POINTS)), key=lambda led: math.dist((x, y), LED_POINTS[led]))
+        row, col = key['matrix']
+        matrix[row][col] = str(nearest)
+
+    out = [
+        '// Generated by scripts/gen_led_map.py from keyboard.json, do not edit.',
+        '',
+        '#pragma once',
+        '',
+        '// Nearest LED of every matrix position.',
+        '#define LED_MAP_MATRIX { \\',
+    ]
+    out += ['    { ' + ', '.join(f'{led:>6}' for led in line) + ' }, \\' for line in matrix]
+    out.append('}')
+    out.append('')
+    out.append('#define LED_MAP_POINTS { \\')
+    out.append('    ' + ', '.join(f'{{ {x}, {y} }}' for x, y in LED_POINTS) + ' \\')
+    out.append('}')
+    out.append('')
+    out.append('#define LED_MAP_FLAGS { ' + ', '.join(str(flag) for flag in LED_FLAGS) + ' }')
+    out.append('')
+    out.append('// Distance between two LEDs in the 224x64 space, capped at 255.')
+    out.append('#define LED_MAP_DISTANCES { \\')
+    for a in LED_POINTS:
+        out.append('    { ' + ', '.join(f'{min(255, round(math.dist(a, b))):>3}' for b in LED_POINTS) + ' }, \\')
+    out.append('}')
+    out.append('')
+    (KEYBOARD_DIR / 'led_map.h').write_text('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Generate a sparse copy of a keymap's `keymaps[]` table.
+
+Each layer is stored as a bitmap of the positions that differ from the
+layer's most common keycode (its fill), plus those keycodes packed in matrix
+order. A lookup is a bitmap test, a popcount and one read, so it stays
+constant time while mostly empty layers shrink to a few words.
+
+The dense `keymaps[]` in keymap.c stays the source of truth:
+
+    gen_sparse_keymap.py keyboards/syndrome/keymaps/sherman
+
+writes sparse_keymap.h next to keymap.c. The header is only rewritten when
+its contents change, so it is safe to run on every build.
+"""
+
+import json
+import re
+import sys
+from collections import Counter
+from pathlib import Path
+
+KEYBOARD_DIR = Path(__file__).resolve().parent.parent
+
+
+def split_args(text):
+    """Splits a comma separated argument list, keeping nested calls whole."""
+    args, depth, current = [], 0, ''
+    for char in text:
+        if char == ',' and depth == 0:
+            args.append(current.strip())
+            current = ''
+            continue
+        depth += char == '('
+        depth -= char == ')'
+        current += char
+    if current.strip():
+        args.append(current.strip())
+    return args
+
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+    return re.sub(r'//[^\n]*', '', text)
+
+
+def read_layers(keymap_c):
+    source = strip_comments(keymap_c.read_text())
+    table = re.search(r'keymaps\s*\[\]\s*\[MATRIX_ROWS\]\s*\[MATRIX_COLS\]\s*=\s*\{', source)
+    if not table:
+        sys.exit(f'{keymap_c}: no keymaps[] table')
+
+    layers, pos = [], table.end()
+    layer = re.compile(r'\s*\[(\w+)\]\s*=\s*LAYOUT\(')
+    while True:
+        match = layer.match(source, pos)
+        if not match:
+            break
+        depth, end = 1, match.end()
+        while depth:
+            depth += source[end] == '('
+            depth -= source[end] == ')'
+            end += 1
+        layers.append((match.group(1), split_args(source[match.end():end - 1])))
+        pos = source.find(',', end)
+        if pos < 0 or source[end:pos].strip():
+            break
+        pos += 1
+    return layers
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(f'usage: {sys.argv[0]} <keymap dir>')
+    keymap_dir = Path(sys.argv[1])
+
+    info = json.loads((KEYBOARD_DIR / 'keyboard.json').read_text())
+    rows = len(info['matrix_pins']['rows'])
+    cols = len(info['matrix_pins']['cols'])
+    layout = [key['matrix'] for key in info['layouts']['LAYOUT']['layout']]
+
+    layers = read_layers(keymap_dir / 'keymap.c')
+    if not layers:
+        sys.exit('no layers found')
+
+    row_bits, row_base, layer_base, fills, keys = [], [], [], [], []
+    for name, keycodes in layers:
+        if len(keycodes) != len(layout):
+            sys.exit(f'layer {name}: {len(keycodes)} keys, LAYOUT has {len(layout)}')
+        # Unwired positions are zero (KC_NO) in the dense table too.
+        grid = [['KC_NO'] * cols for _ in range(rows)]
+        for (row, col), keycode in zip(layout, keycodes):
+            grid[row][col] = keycode
+        fill = Counter(key for line in grid for key in line).most_common(1)[0][0]
+
+        layer_base.append(len(keys))
+        bits_of_layer, base_of_layer = [], []
+        for row in range(rows):
+            base_of_layer.append(len(keys) - layer_base[-1])
+            bits = 0
+            for col in range(cols):
+                if grid[row][col] != fill:
+                    bits |= 1 << col
+                    keys.append(grid[row][col])
+            bits_of_layer.append(bits)
+        row_bits.append(bits_of_layer)
+        row_base.append(base_of_layer)
+        fills.append(fill)
+
+    if max(max(base) for base in row_base) > 0xFF:
+        sys.exit('a layer has more than 255 keys')
+
+    names = [name for name, _ in layers]
+    out = []
+    out.append('// Generated by scripts/gen_sparse_keymap.py from keymap.c, do not edit.')
+    out.append('')
+    out.append('#pragma once')
+    out.append('')
+    out.append(f'#define SPARSE_KEYMAP_LAYERS {len(layers)}')
+    out.append('')
+    out.append(f'// {len(keys)} stored keys, {len(layers) * rows * cols - len(keys)} taken from the layer fill.')
+    out.append('static const uint16_t PROGMEM sparse_fill[SPARSE_KEYMAP_LAYERS] = {')
+    out += [f'    [{name}] = {fill},' for name, fill in zip(names, fills)]
+    out.append('};')
+    out.append('')
+    out.append('// Columns of each row that differ from the fill.')
+    out.append('static const uint8_t PROGMEM sparse_row_bits[SPARSE_KEYMAP_LAYERS][MATRIX_ROWS] = {')
+    out += [f'    [{name}] = {{ {", ".join(f"0x{b:02X}" for b in bits)} }},' for name, bits in zip(names, row_bits)]
+    out.append('};')
+    out.append('')
+    out.append('// First stored key of each layer, and of each row within it.')
+    out.append('static const uint16_t PROGMEM sparse_layer_base[SPARSE_KEYMAP_LAYERS] = {')
+    out += [f'    [{name}] = {base},' for name, base in zip(names, layer_base)]
+    out.append('};')
+    out.append('static const uint8_t PROGMEM sparse_row_base[SPARSE_KEYMAP_LAYERS][MATRIX_ROWS] = {')
+    out += [f'    [{name}] = {{ {", ".join(str(b) for b in base)} }},' for name, base in zip(names, row_base)]
+    out.append('};')
+    out.append('')
+    out.append('static const uint16_t PROGMEM sparse_keys[] = {')
+    for name, start, end in zip(names, layer_base, layer_base[1:] + [len(keys)]):
+        out.append(f'    // {name}')
+        for i in range(start, end, 6):
+            out.append('    ' + ' '.join(f'{key},' for key in keys[i:min(i + 6, end)]))
+    out.append('};')
+    out.append('')
+
+    header = keymap_dir / 'sparse_keymap.h'
+    text = '\n'.join(out)
+    if not header.exists() or header.read_text() != text:
+        header.write_text(text)
+
+
+if __name__ == '__main__':
+    main()
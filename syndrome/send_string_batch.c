@@ -0,0 +1,171 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "send_string_batch.h"
+
+#ifdef NKRO_ENABLE
+#    define BATCH_MAX_KEYS 16
+#else
+#    define BATCH_MAX_KEYS 1
+#endif
+
+// Keys currently down in the report, in the order they were pressed. The last
+// `batch_fresh` of them were added since the report was last sent.
+static uint8_t batch_keys[BATCH_MAX_KEYS];
+static uint8_t batch_count = 0;
+static uint8_t batch_fresh = 0;
+static uint8_t batch_mods  = 0;
+
+static bool lut_bit(const uint8_t *lut, uint8_t pos) {
+    return (pgm_read_byte(&lut[pos / 8]) >> (pos % 8)) & 0x01;
+}
+
+static void batch_send_report(void) {
+    send_keyboard_report();
+#if TAP_CODE_DELAY > 0
+    wait_ms(TAP_CODE_DELAY);
+#endif
+    batch_fresh = 0;
+}
+
+static void batch_release_keys(void) {
+    for (uint8_t i = 0; i < batch_count; i++) {
+        del_key(batch_keys[i]);
+    }
+    batch_count = 0;
+    batch_fresh = 0;
+}
+
+static bool batch_holds(uint8_t keycode) {
+    for (uint8_t i = 0; i < batch_count; i++) {
+        if (batch_keys[i] == keycode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint8_t batch_limit(void) {
+#ifdef NKRO_ENABLE
+    return keymap_config.nkro ? BATCH_MAX_KEYS : 1;
+#else
+    return 1;
+#endif
+}
+
+static void batch_add(uint8_t keycode, uint8_t mods) {
+    // Join the frame being built only if the host will read it in string order.
+    bool join = batch_fresh > 0 && mods == batch_mods && batch_count < batch_limit() && keycode > batch_keys[batch_count - 1];
+
+    if (batch_fresh > 0 && !join) {
+        batch_send_report();
+    }
+
+    if (batch_fresh == 0) {
+        if (mods != batch_mods || batch_holds(keycode)) {
+            // A repeated key needs a release edge, and modifiers change on
+            // their own report so they can't apply to the wrong key.
+            batch_release_keys();
+            del_weak_mods(batch_mods);
+            add_weak_mods(mods);
+            batch_mods = mods;
+            batch_send_report();
+        } else {
+            // The previous frame is released in the same report as this press.
+            batch_release_keys();
+        }
+    }
+
+    add_key(keycode);
+    batch_keys[batch_count++] = keycode;
+    batch_fresh++;
+}
+
+static void batch_flush(void) {
+    if (batch_fresh > 0) {
+        batch_send_report();
+    }
+    if (batch_count > 0 || batch_mods) {
+        batch_release_keys();
+        del_weak_mods(batch_mods);
+        batch_mods = 0;
+        batch_send_report();
+    }
+}
+
+static void batch_char(char ascii_code) {
+    uint8_t code = (uint8_t)ascii_code;
+    if (code >= 128 || lut_bit(ascii_to_dead_lut, code)) {
+        batch_flush();
+        send_char(ascii_code);
+        return;
+    }
+
+    uint8_t keycode = pgm_read_byte(&ascii_to_keycode_lut[code]);
+    uint8_t mods    = 0;
+    if (lut_bit(ascii_to_shift_lut, code)) {
+        mods |= MOD_BIT(KC_LEFT_SHIFT);
+    }
+    if (lut_bit(ascii_to_altgr_lut, code)) {
+        mods |= MOD_BIT(KC_RIGHT_ALT);
+    }
+    batch_add(keycode, mods);
+}
+
+static void send_string_batched_impl(char (*getter)(const char **), const char *string) {
+    char ascii_code;
+    while ((ascii_code = getter(&string)) != 0) {
+        if (ascii_code != SS_QMK_PREFIX) {
+            batch_char(ascii_code);
+            continue;
+        }
+
+        batch_flush();
+        ascii_code = getter(&string);
+        if (ascii_code == SS_TAP_CODE) {
+            tap_code(getter(&string));
+        } else if (ascii_code == SS_DOWN_CODE) {
+            register_code(getter(&string));
+        } else if (ascii_code == SS_UP_CODE) {
+            unregister_code(getter(&string));
+        } else if (ascii_code == SS_DELAY_CODE) {
+            uint16_t ms = 0;
+            char     digit;
+            while ((digit = getter(&string)) >= '0' && digit <= '9') {
+                ms = ms * 10 + (digit - '0');
+            }
+            wait_ms(ms);
+        }
+    }
+    batch_flush();
+}
+
+static char ram_getter(const char **string) {
+    return *(*string)++;
+}
+
+static char pgm_getter(const char **string) {
+    return pgm_read_byte((*string)++);
+}
+
+void send_string_batched(const char *string) {
+    send_string_batched_impl(ram_getter, string);
+}
+
+void send_string_batched_P(const char *string) {
+    send_string_batched_impl(pgm_getter, string);
+}
@@ -0,0 +1,34 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "quantum.h"
+
+/*
+ * Drop-in replacement for send_string() that needs fewer reports per character.
+ *
+ * Each report presses the next character while releasing the previous one, so
+ * a key is only released on its own when the same key repeats or the
+ * modifiers change. With NKRO on, runs of characters whose keycodes ascend in
+ * HID order are pressed in a single report, which hosts read in usage order.
+ * SS_TAP/SS_DOWN/SS_UP/SS_DELAY codes and dead keys fall back to the stock
+ * behaviour.
+ */
+void send_string_batched(const char *string);
+void send_string_batched_P(const char *string);
+
+#define SEND_STRING_BATCHED(string) send_string_batched_P(PSTR(string))
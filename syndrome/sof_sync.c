@@ -0,0 +1,121 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Start-of-frame synchronised scanning.
+ *
+ * The host polls the keyboard endpoint once per 1 ms USB frame. Scanning is
+ * held back until the last SOF_SYNC_LEAD_US before the next frame, so the
+ * report built from a scan is as fresh as possible when it is collected.
+ *
+ * The USB driver owns the SOF interrupt, so the frame number is polled from
+ * the controller instead. A frame is only ever seen after it started, so the
+ * estimated frame start is predicted forward and pulled back whenever a frame
+ * is seen earlier than predicted. The prediction runs 1 us long per frame to
+ * keep it from drifting ahead of the host clock.
+ *
+ * With no frames (unplugged or suspended) scanning free-runs.
+ *
+ * Report age is measured against the same frame estimate whether or not
+ * scans are gated, so sof_sync_set_gated(false) gives the free-running
+ * baseline to compare the gated figures with.
+ */
+
+#include "sof_sync.h"
+#include "debug.h"
+
+#include "hardware/structs/usb.h"
+#include "hardware/structs/timer.h"
+
+#define SOF_PERIOD_US 1000
+#define SOF_LOST_US (3 * SOF_PERIOD_US)
+
+// Stats are printed to the console every this many samples.
+#define SOF_STATS_PRINT 256
+
+static uint16_t last_frame  = 0;
+static uint32_t last_sof_us = 0;
+
+static bool gated = SOF_SYNC_GATE;
+
+static uint32_t age_avg_q4 = 0;
+static uint16_t age_max_us = 0;
+static uint32_t samples    = 0;
+
+static void poll_sof(uint32_t now) {
+    uint16_t frame = usb_hw->sof_rd & USB_SOF_RD_BITS;
+    if (frame == last_frame) {
+        return;
+    }
+
+    uint16_t frames    = (frame - last_frame) & USB_SOF_RD_BITS;
+    uint32_t predicted = last_sof_us + frames * (SOF_PERIOD_US + 1);
+    if (now - last_sof_us > SOF_LOST_US || (int32_t)(now - predicted) < 0 || now - predicted >= SOF_PERIOD_US) {
+        predicted = now;
+    }
+    last_frame  = frame;
+    last_sof_us = predicted;
+}
+
+bool sof_sync_scan_due(void) {
+    uint32_t now = timer_hw->timerawl;
+    poll_sof(now);
+
+    uint32_t since = now - last_sof_us;
+    return !gated || since >= SOF_PERIOD_US - SOF_SYNC_LEAD_US || since > SOF_LOST_US;
+}
+
+void sof_sync_scan_done(bool changed) {
+    if (!changed) {
+        return;
+    }
+
+    uint32_t since = timer_hw->timerawl - last_sof_us;
+    if (since > SOF_LOST_US) {
+        return;
+    }
+    uint16_t age = SOF_PERIOD_US - since % SOF_PERIOD_US;
+
+    if (age > age_max_us) {
+        age_max_us = age;
+    }
+    // Moving average over roughly the last 16 samples, in 1/16 us.
+    age_avg_q4 = samples ? age_avg_q4 - (age_avg_q4 >> 4) + age : (uint32_t)age << 4;
+    samples++;
+
+    if (samples % SOF_STATS_PRINT == 0) {
+        dprintf("sof sync: %s report age avg %u us, max %u us\n", gated ? "gated" : "free-running", (unsigned)(age_avg_q4 >> 4), (unsigned)age_max_us);
+    }
+}
+
+void sof_sync_get_stats(sof_sync_stats_t *stats) {
+    stats->age_avg_us = age_avg_q4 >> 4;
+    stats->age_max_us = age_max_us;
+    stats->samples    = samples;
+    stats->gated      = gated;
+}
+
+void sof_sync_reset_stats(void) {
+    age_avg_q4 = 0;
+    age_max_us = 0;
+    samples    = 0;
+}
+
+void sof_sync_set_gated(bool gate) {
+    gated = gate;
+    sof_sync_reset_stats();
+}
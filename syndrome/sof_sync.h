@@ -0,0 +1,49 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How long before the next start of frame the matrix may be scanned.
+#ifndef SOF_SYNC_LEAD_US
+#    define SOF_SYNC_LEAD_US 250
+#endif
+
+// Start with scans held back to the frame (1) or free-running (0). Both
+// record the same stats, so a free-running build gives the baseline.
+#ifndef SOF_SYNC_GATE
+#    define SOF_SYNC_GATE 1
+#endif
+
+// Report age: time from the scan that saw a change to the next host poll.
+typedef struct {
+    uint16_t age_avg_us;
+    uint16_t age_max_us;
+    uint32_t samples;
+    bool     gated; // mode the samples were taken in
+} sof_sync_stats_t;
+
+bool sof_sync_scan_due(void);
+void sof_sync_scan_done(bool changed);
+
+// Switches between gated and free-running scans, resetting the stats.
+void sof_sync_set_gated(bool gated);
+
+void sof_sync_get_stats(sof_sync_stats_t *stats);
+void sof_sync_reset_stats(void);
@@ -0,0 +1,52 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Keymap lookups from the sparse copy of keymaps[] in sparse_keymap.h,
+ * generated by scripts/gen_sparse_keymap.py. The dense table in keymap.c
+ * stays the source of truth but is no longer referenced, so it is dropped at
+ * link time.
+ *
+ * The keymap provides layers.h with its layer enum, which the generated
+ * keycodes refer to. This lives outside keymap.c because QMK compiles
+ * keymap.c into the same unit as the default lookups it overrides.
+ */
+
+#include QMK_KEYBOARD_H
+#include "keymap_introspection.h"
+#include "layers.h"
+#include "sparse_keymap.h"
+
+static const uint8_t nibble_bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+uint8_t keymap_layer_count(void) {
+    return SPARSE_KEYMAP_LAYERS;
+}
+
+uint16_t keycode_at_keymap_location(uint8_t layer_num, uint8_t row, uint8_t column) {
+    if (layer_num >= SPARSE_KEYMAP_LAYERS || row >= MATRIX_ROWS || column >= MATRIX_COLS) {
+        return KC_TRNS;
+    }
+    uint8_t bits = pgm_read_byte(&sparse_row_bits[layer_num][row]);
+    if (!(bits & (1 << column))) {
+        return pgm_read_word(&sparse_fill[layer_num]);
+    }
+    // Stored keys of a row are packed in column order.
+    uint8_t  before = bits & ((1 << column) - 1);
+    uint16_t index  = pgm_read_word(&sparse_layer_base[layer_num]) + pgm_read_byte(&sparse_row_base[layer_num][row]) + nibble_bits[before & 0x0F] + nibble_bits[before >> 4];
+    return pgm_read_word(&sparse_keys[index]);
+}
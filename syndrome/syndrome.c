@@ -16,22 +16,238 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "quantum.h"
+#include "timer_us.h"
+#include "defer.h"
+#include "events.h"
+#include "led_map.h"
+#include "wpm.h"
 
-led_config_t g_led_config = { {
-    {NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED},
-    { 6, 5, 4, 3, 2, 1, 0, NO_LED },
-    { 7,  NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, NO_LED, 15 },
-    { 8 , 9, NO_LED, 10, 11, 12, 13, 14 },
-    { NO_LED,  NO_LED,  NO_LED,NO_LED, NO_LED, NO_LED, NO_LED, NO_LED }
-}, {
-    { 183,0 }, { 162,0 }, { 142,0 }, { 122,0 }, { 81,0 }, { 61,0 }, { 40,0 },
-    { 20,16 }, { 40,48 },
-    { 61,48 }, { 81,48 }, { 101,48 }, { 122,48 }, { 162,48 }, { 203,48 }, { 244,16 }
-}, {
-    1, 1, 1, 1, 1, 1, 1,
-    1, 1,
-    1, 1, 1, 1, 1, 1, 1
-} };
+#ifdef OLED_ENABLE
+#include "i2c_master.h"
+#endif
+#ifdef OS_DETECTION_ENABLE
+#include "os_detection.h"
+#endif
+#ifdef DMACRO_ENABLE
+#include "dmacro.h"
+#endif
+#ifdef SYNDROME_MOUSE_ENGINE
+#include "mouse_engine.h"
+#endif
+#if defined(RGB_MATRIX_ENABLE) && defined(RGB_MATRIX_CUSTOM_KB)
+#include "rgb_effects.h"
+#endif
+
+// With a static encoder map, encoders bound to KC_NO on every layer are left
+// unconfigured and never read. VIA can remap them at runtime, so it keeps all.
+#if defined(ENCODER_ENABLE) && defined(ENCODER_MAP_ENABLE) && !defined(DYNAMIC_KEYMAP_ENABLE)
+#    define SKIP_DEAD_ENCODERS
+#    include "keymap_introspection.h"
+#endif
+
+#ifdef RGB_MATRIX_ENABLE
+// Every key lights its nearest LED, see scripts/gen_led_map.py.
+led_config_t g_led_config = {
+    LED_MAP_MATRIX,
+    LED_MAP_POINTS,
+    LED_MAP_FLAGS,
+};
+#endif
+
+#ifdef SKIP_DEAD_ENCODERS
+static const pin_t encoder_pins_a[NUM_ENCODERS] = ENCODER_A_PINS;
+static const pin_t encoder_pins_b[NUM_ENCODERS] = ENCODER_B_PINS;
+
+static uint8_t live_encoders = 0;
+
+static void find_live_encoders(void) {
+    for (uint8_t layer = 0; layer < encodermap_layer_count(); layer++) {
+        for (uint8_t index = 0; index < NUM_ENCODERS; index++) {
+            if (keycode_at_encodermap_location(layer, index, true) != KC_NO || keycode_at_encodermap_location(layer, index, false) != KC_NO) {
+                live_encoders |= 1 << index;
+            }
+        }
+    }
+}
+
+void encoder_quadrature_init_pin(uint8_t index, bool pad_b) {
+    if (live_encoders & (1 << index)) {
+        gpio_set_pin_input_high(pad_b ? encoder_pins_b[index] : encoder_pins_a[index]);
+    }
+}
+
+// A dead encoder reads a constant state, so it never produces a step.
+uint8_t encoder_quadrature_read_pin(uint8_t index, bool pad_b) {
+    if (!(live_encoders & (1 << index))) {
+        return 0;
+    }
+    return gpio_read_pin(pad_b ? encoder_pins_b[index] : encoder_pins_a[index]) ? 1 : 0;
+}
+#endif
+
+void keyboard_pre_init_kb(void) {
+#ifdef SKIP_DEAD_ENCODERS
+    find_live_encoders();
+#endif
+    keyboard_pre_init_user();
+}
+
+#ifdef OS_DETECTION_ENABLE
+// The last settled host OS is kept in the keyboard EEPROM block. It is handed
+// to the keymap at startup so the right modifiers apply from the first
+// keystroke, and replaced once detection settles on the new host.
+bool process_detected_host_os_kb(os_variant_t detected_os) {
+    if (detected_os != OS_UNSURE && detected_os != (os_variant_t)eeconfig_read_kb()) {
+        eeconfig_update_kb(detected_os);
+    }
+    events_publish(EVENT_HOST_OS, detected_os);
+    return process_detected_host_os_user(detected_os);
+}
+#endif
+
+void keyboard_post_init_kb(void) {
+#ifdef OS_DETECTION_ENABLE
+    os_variant_t cached_os = (os_variant_t)eeconfig_read_kb();
+    if (detected_host_os() == OS_UNSURE && cached_os != OS_UNSURE) {
+        events_publish(EVENT_HOST_OS, cached_os);
+        process_detected_host_os_user(cached_os);
+    }
+#endif
+#ifdef DMACRO_ENABLE
+    dmacro_init();
+#endif
+    keyboard_post_init_user();
+}
+
+// Arrival times of the most recent matrix events. Tap-hold can hold back
+// several events of one key (a double tap during an undecided mod-tap), so
+// each stamp is kept with its event and found again by key, direction and
+// the event's own millisecond time rather than per matrix position.
+#ifndef EVENT_STAMPS
+#    define EVENT_STAMPS 16
+#endif
+
+typedef struct {
+    uint32_t time_us;
+    uint16_t time_ms; // record->event.time
+    keypos_t key;
+    bool     pressed;
+} event_stamp_t;
+
+static event_stamp_t event_stamps[EVENT_STAMPS];
+static uint8_t       event_stamp_next = 0;
+
+uint32_t event_time_us(const keyrecord_t *record) {
+    const keyevent_t *event = &record->event;
+    if (!IS_KEYEVENT(*event)) {
+        return timer_read_us();
+    }
+    for (uint8_t i = 1; i <= EVENT_STAMPS; i++) {
+        const event_stamp_t *stamp = &event_stamps[(event_stamp_next + EVENT_STAMPS - i) % EVENT_STAMPS];
+        if (stamp->time_ms == event->time && stamp->pressed == event->pressed && KEYEQ(stamp->key, event->key)) {
+            return stamp->time_us;
+        }
+    }
+    // Stamp already overwritten: rebuild it from the millisecond time.
+    return timer_read_us() - (uint32_t)timer_elapsed(event->time) * 1000;
+}
+
+layer_state_t layer_state_set_kb(layer_state_t state) {
+    state = layer_state_set_user(state);
+    events_publish(EVENT_LAYER, get_highest_layer(state));
+    return state;
+}
+
+bool led_update_kb(led_t led_state) {
+    events_publish(EVENT_LEDS, led_state.raw);
+    return led_update_user(led_state);
+}
+
+bool pre_process_record_kb(uint16_t keycode, keyrecord_t *record) {
+    keypos_t key = record->event.key;
+    if (IS_KEYEVENT(record->event) && key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+        uint32_t now = timer_read_us();
+#ifdef SYNDROME_ISR_SCAN
+        // Only an event for an edge the scan just delivered gets its time.
+        matrix_take_edge_time_us(key.row, key.col, &now);
+#endif
+        event_stamps[event_stamp_next] = (event_stamp_t){now, record->event.time, key, record->event.pressed};
+        event_stamp_next = (event_stamp_next + 1) % EVENT_STAMPS;
+    }
+#ifdef DMACRO_ENABLE
+    if (!process_dmacro(keycode, record)) {
+        return false;
+    }
+#endif
+    return pre_process_record_user(keycode, record);
+}
+
+bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
+    process_wpm(keycode, record);
+#if defined(RGB_MATRIX_ENABLE) && defined(RGB_MATRIX_CUSTOM_KB)
+    if (record->event.pressed && IS_KEYEVENT(record->event) && rgb_matrix_get_mode() == RGB_MATRIX_CUSTOM_led_heatmap) {
+        rgb_heatmap_hit(record->event.key.row, record->event.key.col);
+    }
+#endif
+    if (!process_record_user(keycode, record)) {
+        return false;
+    }
+#ifdef SYNDROME_MOUSE_ENGINE
+    return process_mouse_engine(keycode, record);
+#else
+    return true;
+#endif
+}
+
+void housekeeping_task_kb(void) {
+    defer_task();
+    events_task();
+#ifdef DMACRO_ENABLE
+    dmacro_task();
+#endif
+#ifdef SYNDROME_MOUSE_ENGINE
+    mouse_engine_task();
+#endif
+    housekeeping_task_user();
+}
+
+#ifdef OLED_ENABLE
+// oled_off() only fades the panel out; switch the panel and its charge pump
+// off outright while suspended. The frame buffer is kept, so nothing is
+// redrawn on wake.
+static void oled_panel_power(bool on) {
+    const uint8_t cmds[] = {0x00, 0x8D, on ? 0x14 : 0x10, on ? 0xAF : 0xAE};
+    i2c_transmit(OLED_DISPLAY_ADDRESS << 1, cmds, sizeof(cmds), OLED_I2C_TIMEOUT);
+}
+#endif
+
+// Called on every pass of the suspend loop, the work is done on the first.
+// RGB_MATRIX_SLEEP blanks the LEDs; the matrix is slowed here, QMK's
+// ChibiOS suspend loop does not call matrix_power_down() itself.
+static bool suspended = false;
+
+void suspend_power_down_kb(void) {
+    if (!suspended) {
+        suspended = true;
+        matrix_power_down();
+#ifdef OLED_ENABLE
+        oled_panel_power(false);
+#endif
+    }
+    suspend_power_down_user();
+}
+
+void suspend_wakeup_init_kb(void) {
+    if (suspended) {
+        suspended = false;
+        matrix_power_up();
+#ifdef OLED_ENABLE
+        oled_panel_power(true);
+        oled_on();
+#endif
+    }
+    suspend_wakeup_init_user();
+}
 
 #ifdef OLED_ENABLE
 
@@ -0,0 +1,62 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "action.h"
+#include "hardware/structs/timer.h"
+
+/*
+ * 32-bit microsecond timebase from the RP2040 1 MHz timer.
+ *
+ * The counter wraps after ~71 minutes. Differences are taken modulo 2^32, so
+ * durations and deadlines are exact as long as they span less than ~35
+ * minutes.
+ */
+
+static inline uint32_t timer_read_us(void) {
+    return timer_hw->timerawl;
+}
+
+static inline uint32_t timer_elapsed_us(uint32_t last) {
+    return timer_read_us() - last;
+}
+
+static inline bool timer_expired_us(uint32_t now, uint32_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+/*
+ * Time a key event entered the pipeline, in microseconds.
+ *
+ * `keyrecord_t` only carries a 16-bit millisecond time, so every matrix event
+ * is stamped on arrival, before tap-hold can buffer it, and the stamp is kept
+ * with that event. Events older than the last EVENT_STAMPS fall back to their
+ * millisecond time. Events that did not come from the matrix (combos,
+ * injected events) read as now.
+ */
+uint32_t event_time_us(const keyrecord_t *record);
+
+#ifdef SYNDROME_ISR_SCAN
+// Time the ISR scan saw the edge matrix_scan_custom() last delivered for a
+// matrix position, see matrix.c. Each edge is handed out once; returns false
+// if it was already taken or the event did not come from a fresh edge.
+bool matrix_take_edge_time_us(uint8_t row, uint8_t col, uint32_t *time_us);
+#endif
@@ -0,0 +1,173 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "quantum.h"
+#include "raw_hid.h"
+#include "via.h"
+#include "dynamic_keymap.h"
+#include "eeprom.h"
+#include "via_cache.h"
+#include "defer.h"
+#ifdef VIAL_ENABLE
+#    include "vial.h"
+#endif
+
+// Where dynamic_keymap.c keeps the keymap, which is stored in the same
+// big-endian layer, row, column order as the VIA buffer.
+#ifndef DYNAMIC_KEYMAP_EEPROM_START
+#    define DYNAMIC_KEYMAP_EEPROM_START (VIA_EEPROM_CONFIG_END)
+#endif
+
+#define KEYMAP_BYTES (DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2)
+#define KEYMAP_KEYS (KEYMAP_BYTES / 2)
+
+// Keymap in the VIA buffer format. Only valid while something is pending.
+static uint8_t image[KEYMAP_BYTES];
+// Keycodes changed in image since it was read.
+static uint8_t dirty[(KEYMAP_KEYS + 7) / 8];
+static bool    pending = false;
+
+static defer_token_t flush_token = DEFER_INVALID_TOKEN;
+
+void via_cache_flush(void) {
+    if (!pending) {
+        return;
+    }
+    defer_cancel(flush_token);
+    flush_token = DEFER_INVALID_TOKEN;
+    // One block write per run of changed keycodes rather than the byte at a
+    // time writes of dynamic_keymap_set_buffer().
+    uint16_t key = 0;
+    while (key < KEYMAP_KEYS) {
+        if (!(dirty[key / 8] & (1 << (key % 8)))) {
+            key++;
+            continue;
+        }
+        uint16_t start = key;
+        while (key < KEYMAP_KEYS && (dirty[key / 8] & (1 << (key % 8)))) {
+            key++;
+        }
+        eeprom_write_block(image + start * 2, (void *)(uintptr_t)(DYNAMIC_KEYMAP_EEPROM_START + start * 2), (key - start) * 2);
+    }
+    memset(dirty, 0, sizeof(dirty));
+    pending = false;
+}
+
+static uint32_t flush_due(uint32_t trigger_time, void *arg) {
+    flush_token = DEFER_INVALID_TOKEN;
+    via_cache_flush();
+    return 0;
+}
+
+static uint16_t keymap_bytes(void) {
+    return dynamic_keymap_get_layer_count() * MATRIX_ROWS * MATRIX_COLS * 2;
+}
+
+static void begin_write(void) {
+    if (!pending) {
+        dynamic_keymap_get_buffer(0, keymap_bytes(), image);
+        pending = true;
+    }
+    if (!defer_extend_us(flush_token, VIA_CACHE_FLUSH_MS * 1000UL)) {
+        flush_token = defer_exec_us(VIA_CACHE_FLUSH_MS * 1000UL, flush_due, NULL);
+    }
+}
+
+static void write_keycode(uint16_t offset, uint16_t keycode) {
+#ifdef VIAL_ENABLE
+    // Same firewall as Vial: no reset key on a locked board.
+    if (!vial_unlocked && keycode == QK_BOOT) {
+        return;
+    }
+#endif
+    if (image[offset] == keycode >> 8 && image[offset + 1] == (keycode & 0xFF)) {
+        return;
+    }
+    image[offset]     = keycode >> 8;
+    image[offset + 1] = keycode & 0xFF;
+    dirty[offset / 16] |= 1 << (offset / 2 % 8);
+}
+
+static uint16_t key_offset(const uint8_t *data) {
+    return ((data[0] * MATRIX_ROWS + data[1]) * MATRIX_COLS + data[2]) * 2;
+}
+
+static bool valid_key(const uint8_t *data) {
+    return data[0] < dynamic_keymap_get_layer_count() && data[1] < MATRIX_ROWS && data[2] < MATRIX_COLS;
+}
+
+// Buffer commands carry a big-endian offset, a byte count and the bytes.
+static bool valid_buffer(const uint8_t *data, uint8_t length) {
+    uint16_t offset = (data[0] << 8) | data[1];
+    uint8_t  count  = data[2];
+    return count <= length - 4 && offset + count <= keymap_bytes();
+}
+
+// Leaves the command to VIA, which works on the EEPROM copy.
+static bool pass_through(void) {
+    via_cache_flush();
+    return false;
+}
+
+bool via_command_kb(uint8_t *data, uint8_t length) {
+    uint8_t *command_data = &data[1];
+    uint16_t offset       = (command_data[0] << 8) | command_data[1];
+    uint8_t  count        = command_data[2];
+
+    switch (data[0]) {
+        case id_dynamic_keymap_set_keycode:
+            if (!valid_key(command_data)) {
+                return pass_through();
+            }
+            begin_write();
+            write_keycode(key_offset(command_data), (command_data[3] << 8) | command_data[4]);
+            break;
+
+        case id_dynamic_keymap_get_keycode:
+            if (!pending || !valid_key(command_data)) {
+                return pass_through();
+            }
+            memcpy(&command_data[3], &image[key_offset(command_data)], 2);
+            break;
+
+        case id_dynamic_keymap_set_buffer:
+            // Whole keycodes only, anything else takes the normal path.
+            if (((offset | count) & 1) || !valid_buffer(command_data, length)) {
+                return pass_through();
+            }
+            begin_write();
+            for (uint8_t i = 0; i < count; i += 2) {
+                write_keycode(offset + i, (command_data[3 + i] << 8) | command_data[4 + i]);
+            }
+            break;
+
+        case id_dynamic_keymap_get_buffer:
+            if (!pending || !valid_buffer(command_data, length)) {
+                return pass_through();
+            }
+            memcpy(&command_data[3], &image[offset], count);
+            break;
+
+        default:
+            // Anything else may read or reset the keymap through EEPROM.
+            return pass_through();
+    }
+    raw_hid_send(data, length);
+    return true;
+}
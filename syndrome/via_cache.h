@@ -0,0 +1,39 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+/*
+ * Write-back cache for VIA/Vial keymap writes.
+ *
+ * Every set keycode or set buffer packet from the host would otherwise go to
+ * the emulated EEPROM, and so to flash, while the host waits for the reply.
+ * Writes are collected in a RAM mirror of the dynamic keymap instead, reads
+ * are answered from it, and the keycodes that changed are written back after
+ * VIA_CACHE_FLUSH_MS without further writes or before any other command, one
+ * EEPROM block write per run of changed keycodes.
+ *
+ * Until then the keyboard itself still types with the old keymap, and edits
+ * made in the last VIA_CACHE_FLUSH_MS are lost if the board loses power.
+ */
+
+#ifndef VIA_CACHE_FLUSH_MS
+#    define VIA_CACHE_FLUSH_MS 300
+#endif
+
+// Writes back pending keymap changes now.
+void via_cache_flush(void);
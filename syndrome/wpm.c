@@ -0,0 +1,110 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "quantum.h"
+#include "wpm.h"
+#include "defer.h"
+#include "events.h"
+
+_Static_assert(WPM_BURST_BUCKETS > 0 && WPM_BURST_BUCKETS < WPM_WINDOW_BUCKETS, "wpm: burst window must be inside the ring");
+
+static uint8_t  buckets[WPM_WINDOW_BUCKETS];
+static uint8_t  head        = 0;
+static uint32_t head_start  = 0;
+static uint16_t total       = 0;
+static uint16_t burst_total = 0;
+
+static defer_token_t boundary_token = DEFER_INVALID_TOKEN;
+
+// Moves the head up to the bucket holding now, dropping what leaves the windows.
+static void advance(void) {
+    uint32_t passed = timer_elapsed32(head_start) / WPM_BUCKET_MS;
+    if (!passed) {
+        return;
+    }
+    head_start += passed * WPM_BUCKET_MS;
+    if (passed >= WPM_WINDOW_BUCKETS) {
+        memset(buckets, 0, sizeof(buckets));
+        total = burst_total = 0;
+        return;
+    }
+    while (passed--) {
+        head = (head + 1) % WPM_WINDOW_BUCKETS;
+        total -= buckets[head];
+        burst_total -= buckets[(head + WPM_WINDOW_BUCKETS - WPM_BURST_BUCKETS) % WPM_WINDOW_BUCKETS];
+        buckets[head] = 0;
+    }
+}
+
+// keystrokes / 5 per minute over the window.
+static uint8_t to_wpm(uint16_t keystrokes, uint8_t bucket_count) {
+    uint32_t wpm = (uint32_t)keystrokes * 12000 / (bucket_count * WPM_BUCKET_MS);
+    return wpm > UINT8_MAX ? UINT8_MAX : wpm;
+}
+
+uint8_t wpm_sustained(void) {
+    advance();
+    return to_wpm(total, WPM_WINDOW_BUCKETS);
+}
+
+uint8_t wpm_burst(void) {
+    advance();
+    return to_wpm(burst_total, WPM_BURST_BUCKETS);
+}
+
+static uint32_t bucket_boundary(uint32_t trigger_time, void *arg) {
+    events_publish(EVENT_WPM, wpm_sustained());
+    if (!total) {
+        boundary_token = DEFER_INVALID_TOKEN;
+        return 0;
+    }
+    return WPM_BUCKET_MS * 1000;
+}
+
+static bool counts(uint16_t keycode, keyrecord_t *record) {
+    if (IS_QK_MOD_TAP(keycode) || IS_QK_LAYER_TAP(keycode)) {
+        if (record->tap.count == 0) {
+            return false;
+        }
+        keycode &= 0xFF;
+    }
+    return (keycode >= KC_A && keycode <= KC_0) || (keycode >= KC_SPACE && keycode <= KC_SLASH);
+}
+
+void process_wpm(uint16_t keycode, keyrecord_t *record) {
+    if (!record->event.pressed || !counts(keycode, record)) {
+        return;
+    }
+    advance();
+    if (!total) {
+        // Align buckets to the first keystroke after an idle window.
+        head_start = timer_read32();
+        defer_cancel(boundary_token);
+        boundary_token = DEFER_INVALID_TOKEN;
+    }
+    if (buckets[head] < UINT8_MAX) {
+        buckets[head]++;
+        total++;
+        burst_total++;
+    }
+    events_publish(EVENT_WPM, to_wpm(total, WPM_WINDOW_BUCKETS));
+    if (boundary_token == DEFER_INVALID_TOKEN) {
+        boundary_token = defer_exec_us((WPM_BUCKET_MS - timer_elapsed32(head_start)) * 1000, bucket_boundary, NULL);
+    }
+}
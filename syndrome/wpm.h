@@ -0,0 +1,51 @@
+/*
+Copyright 2024 Nachie
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "action.h"
+
+/*
+ * Words per minute from a ring of fixed-width buckets of keystroke counts.
+ *
+ * A keystroke adds to the newest bucket; buckets that fall out of the window
+ * are dropped lazily the next time the ring is touched. The sustained reading
+ * covers the whole ring, the burst reading only the newest buckets. A word is
+ * five keystrokes.
+ *
+ * While any keystroke is still in the window, a deferred callback at each
+ * bucket boundary publishes EVENT_WPM when the sustained value changes. Once
+ * the window is empty nothing runs until the next keystroke.
+ */
+
+#ifndef WPM_BUCKET_MS
+#    define WPM_BUCKET_MS 500
+#endif
+#ifndef WPM_WINDOW_BUCKETS
+#    define WPM_WINDOW_BUCKETS 16
+#endif
+#ifndef WPM_BURST_BUCKETS
+#    define WPM_BURST_BUCKETS 4
+#endif
+
+uint8_t wpm_sustained(void);
+uint8_t wpm_burst(void);
+
+void process_wpm(uint16_t keycode, keyrecord_t *record);